@@ -23,6 +23,8 @@
 #include "movement.h"
 #include "remoteControl.h"
 #include "audio.h"
+#include "calibration.h"
+#include "grid.h"
 
 
 #define CLOCK_COUNT 16000000
@@ -31,15 +33,18 @@
 #define MYUBRR (FOSC/(16*BAUD))-1 //set ubrr for serial init
 
 
-Object currentObjects[20]; //must empty before each use to prevent residual objects
+ObjectPool currentObjects; //objects found by the last scan, emptied by each scan
 
 
 int main() {
 	
 	//initialize all necessary sensors and utilities
+	calibrationLoad(); //before anything that uses this robot's calibration
+	gridClear(); //the map starts unknown
 	lcd_init();
 	timer1_init();
 	timer3_init();
+	clock_init();
 	move_servo(90);
  	ADC_init();
 	USART_Init(MYUBRR);
@@ -52,12 +57,11 @@ int main() {
 	//oi_play_song(1);
 	
 	while(1) {
-		//empty currentObjects before proceeding by setting all stored objects to "invalid" - ignored by later checks
-		for (int i = 0; i < 20; i++) {
-			currentObjects[i].isValid = 0;
+		if (serial_ready()) {
+			char received = serial_getc(); //take keyboard input from putty
+			takeDirectionInput(received, sensor_data, &currentObjects); //translate keyboard input into functionality
 		}
-		char received = serial_getc(); //take keyboard input from putty
-		takeDirectionInput(received, currentObjects); //translate keyboard input into functionality
+		motionUpdate(sensor_data); //keep driving the queued motion commands between keystrokes
 	}
 	
 	return 0;
@@ -0,0 +1,224 @@
+/*
+ * calibration.c
+ *
+ * Created: 10/17/2026 4:12:21 PM
+ */ 
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "serial.h"
+#include "calibration.h"
+
+#define CALIBRATION_LINE 32 //longest command calibrationEdit accepts
+
+#define FIELD_U8 0
+#define FIELD_I16 1
+#define FIELD_U16 2
+#define FIELD_U32 3
+
+typedef struct { //a calibration value that can be edited over serial
+	const char *name;
+	uint8_t offset; //offset of the value in Calibration
+	uint8_t type; //FIELD_ type of the value
+} CalibrationField;
+
+Calibration calibration; //the record in use, read by the rest of the program
+
+static Calibration EEMEM calibrationRecord; //the saved record
+
+//compile-time fallback, measured on robot 4
+static const Calibration calibrationDefault = {
+	CALIBRATION_VERSION, sizeof(Calibration), CALIBRATION_ROBOT,
+	13, //rotation
+	645, 125, 1030, 1324, //white tape - left, front left, front right, right
+	66, 22, 118, 152, //black tape
+	645, 125, 1030, 1324, //white tape release, no hysteresis until colorCalibrate measures the floor
+	66, 22, 118, 152, //black tape release
+	73118UL, 3825378UL, //ping: 0.06972973 cm per tick and 3.6481622 cm, times 2^20
+	108, 10, 29, //servo
+	0
+};
+
+static const CalibrationField calibrationFields[] = {
+	{"robot", offsetof(Calibration, robot), FIELD_U8},
+	{"rotation", offsetof(Calibration, rotation), FIELD_I16},
+	{"whiteLeft", offsetof(Calibration, whiteLeft), FIELD_U16},
+	{"whiteFrontLeft", offsetof(Calibration, whiteFrontLeft), FIELD_U16},
+	{"whiteFrontRight", offsetof(Calibration, whiteFrontRight), FIELD_U16},
+	{"whiteRight", offsetof(Calibration, whiteRight), FIELD_U16},
+	{"blackLeft", offsetof(Calibration, blackLeft), FIELD_U16},
+	{"blackFrontLeft", offsetof(Calibration, blackFrontLeft), FIELD_U16},
+	{"blackFrontRight", offsetof(Calibration, blackFrontRight), FIELD_U16},
+	{"blackRight", offsetof(Calibration, blackRight), FIELD_U16},
+	{"whiteLeftRelease", offsetof(Calibration, whiteLeftRelease), FIELD_U16},
+	{"whiteFrontLeftRelease", offsetof(Calibration, whiteFrontLeftRelease), FIELD_U16},
+	{"whiteFrontRightRelease", offsetof(Calibration, whiteFrontRightRelease), FIELD_U16},
+	{"whiteRightRelease", offsetof(Calibration, whiteRightRelease), FIELD_U16},
+	{"blackLeftRelease", offsetof(Calibration, blackLeftRelease), FIELD_U16},
+	{"blackFrontLeftRelease", offsetof(Calibration, blackFrontLeftRelease), FIELD_U16},
+	{"blackFrontRightRelease", offsetof(Calibration, blackFrontRightRelease), FIELD_U16},
+	{"blackRightRelease", offsetof(Calibration, blackRightRelease), FIELD_U16},
+	{"pingScale", offsetof(Calibration, pingScale), FIELD_U32},
+	{"pingOffset", offsetof(Calibration, pingOffset), FIELD_U32},
+	{"servoSpan", offsetof(Calibration, servoSpan), FIELD_U16},
+	{"servoTrim", offsetof(Calibration, servoTrim), FIELD_I16},
+	{"servoBase", offsetof(Calibration, servoBase), FIELD_U16}
+};
+
+#define FIELD_COUNT (sizeof(calibrationFields) / sizeof(calibrationFields[0]))
+
+// Sum of every byte of a record but the checksum
+static uint8_t calibrationSum(const Calibration *record) {
+	const uint8_t *bytes = (const uint8_t *) record;
+	uint8_t sum = 0;
+	
+	for (uint8_t i = 0; i < offsetof(Calibration, checksum); i++) {
+		sum += bytes[i];
+	}
+	return sum;
+}
+
+/// Replaces the calibration in use with the compile-time defaults
+/**
+ * Only changes RAM - the saved record is kept until calibrationSave
+ */
+void calibrationDefaults() {
+	calibration = calibrationDefault;
+}
+
+/// Loads the saved calibration from EEPROM
+/**
+ * Called once at boot, before anything reads the calibration. A blank EEPROM, a record saved by a
+ * different version of the code or a corrupt record leaves the compile-time defaults in use.
+ * @return 1 if the saved record was loaded, 0 if the defaults are in use
+ */
+char calibrationLoad() {
+	Calibration record;
+	
+	eeprom_read_block(&record, &calibrationRecord, sizeof(Calibration));
+	if (record.version != CALIBRATION_VERSION || record.size != sizeof(Calibration)
+			|| (uint8_t) (calibrationSum(&record) + record.checksum) != 0) {
+		calibrationDefaults();
+		return 0;
+	}
+	calibration = record;
+	return 1;
+}
+
+/// Saves the calibration in use to EEPROM
+/**
+ * Only bytes that changed are written, which spares the EEPROM's limited write cycles
+ */
+void calibrationSave() {
+	calibration.version = CALIBRATION_VERSION;
+	calibration.size = sizeof(Calibration);
+	calibration.checksum = -calibrationSum(&calibration);
+	eeprom_update_block(&calibration, &calibrationRecord, sizeof(Calibration));
+}
+
+// Value of a field in the calibration in use
+static long fieldGet(const CalibrationField *field) {
+	void *value = (uint8_t *) &calibration + field->offset;
+	
+	switch (field->type) {
+		case FIELD_U8: return *(uint8_t *) value;
+		case FIELD_I16: return *(int16_t *) value;
+		case FIELD_U16: return *(uint16_t *) value;
+		default: return *(uint32_t *) value;
+	}
+}
+
+// Changes a field in the calibration in use
+static void fieldSet(const CalibrationField *field, long newValue) {
+	void *value = (uint8_t *) &calibration + field->offset;
+	
+	switch (field->type) {
+		case FIELD_U8: *(uint8_t *) value = newValue; break;
+		case FIELD_I16: *(int16_t *) value = newValue; break;
+		case FIELD_U16: *(uint16_t *) value = newValue; break;
+		default: *(uint32_t *) value = newValue; break;
+	}
+}
+
+// Sends the name and value of a field over serial
+static void fieldReport(const CalibrationField *field) {
+	char line[40];
+	
+	sprintf(line, "%-22s %ld\n\r", field->name, fieldGet(field));
+	serial_putString(line, strlen(line));
+}
+
+/// Sends every calibration value over serial
+void calibrationReport() {
+	for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+		fieldReport(&calibrationFields[i]);
+	}
+}
+
+/// Reads one calibration command from serial and runs it
+/**
+ * Commands, ended by enter:
+ *   name value - changes a value in RAM, e.g. "rotation 11"
+ *   save       - writes the values in RAM to EEPROM, so they are used after the next reset
+ *   load       - goes back to the values saved in EEPROM
+ *   defaults   - goes back to the compile-time defaults
+ * An empty line lists every value.
+ */
+void calibrationEdit() {
+	char line[CALIBRATION_LINE];
+	uint8_t length = 0;
+	char received;
+	
+	serial_putString("cal> ", 5);
+	while ((received = serial_getc()) != '\r' && received != '\n') {
+		if (received == '\b' && length > 0) {
+			length--;
+			serial_putString("\b \b", 3);
+		}
+		else if (received != '\b' && length < CALIBRATION_LINE - 1) {
+			line[length++] = received;
+			USART_Transmit(received); //echo, putty doesn't
+		}
+	}
+	line[length] = '\0';
+	serial_putString("\n\r", 2);
+	
+	if (length == 0) {
+		calibrationReport();
+	}
+	else if (strcmp(line, "save") == 0) {
+		calibrationSave();
+		serial_putString("Calibration saved.\n\r", 20);
+	}
+	else if (strcmp(line, "load") == 0) {
+		if (calibrationLoad()) {
+			serial_putString("Calibration loaded.\n\r", 21);
+		}
+		else {
+			serial_putString("No saved calibration, using defaults.\n\r", 39);
+		}
+	}
+	else if (strcmp(line, "defaults") == 0) {
+		calibrationDefaults();
+		serial_putString("Calibration defaults restored.\n\r", 32);
+	}
+	else {
+		char *value = strchr(line, ' ');
+		uint8_t i = FIELD_COUNT;
+		
+		if (value) {
+			*value++ = '\0';
+			for (i = 0; i < FIELD_COUNT && strcmp(line, calibrationFields[i].name) != 0; i++);
+		}
+		if (i == FIELD_COUNT) {
+			serial_putString("Unknown calibration command.\n\r", 30);
+			return;
+		}
+		fieldSet(&calibrationFields[i], strtol(value, NULL, 0));
+		fieldReport(&calibrationFields[i]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+ * calibration.h
+ *
+ * Created: 10/17/2026 4:12:37 PM
+ */ 
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <inttypes.h>
+
+#define CALIBRATION_VERSION 2 //bump whenever the layout of Calibration changes - older records are ignored
+#define CALIBRATION_ROBOT 4 //robot the compile-time defaults were measured on
+
+//everything measured per robot, loaded from EEPROM at boot
+typedef struct {
+	uint8_t version; //CALIBRATION_VERSION of the code that saved the record
+	uint8_t size; //sizeof(Calibration) when saved
+	uint8_t robot; //robot number the values were measured on
+	int16_t rotation; //degrees the robot coasts when a script stops a rotation at speed; queued rotations slow down first
+	uint16_t whiteLeft; //cliff signals above these are white tape
+	uint16_t whiteFrontLeft;
+	uint16_t whiteFrontRight;
+	uint16_t whiteRight;
+	uint16_t blackLeft; //cliff signals below these are black tape
+	uint16_t blackFrontLeft;
+	uint16_t blackFrontRight;
+	uint16_t blackRight;
+	uint16_t whiteLeftRelease; //once a sensor sees white tape it keeps seeing it until its signal falls below its value here
+	uint16_t whiteFrontLeftRelease;
+	uint16_t whiteFrontRightRelease;
+	uint16_t whiteRightRelease;
+	uint16_t blackLeftRelease; //once a sensor sees black tape it keeps seeing it until its signal rises above its value here
+	uint16_t blackFrontLeftRelease;
+	uint16_t blackFrontRightRelease;
+	uint16_t blackRightRelease;
+	uint32_t pingScale; //ping distance in cm per timer tick, 2^20 fixed point
+	uint32_t pingOffset; //ping distance in cm at zero ticks, 2^20 fixed point
+	uint16_t servoSpan; //servo pulse width change over 180 degrees
+	int16_t servoTrim; //degrees added before converting, centers the servo
+	uint16_t servoBase; //pulse width at -servoTrim degrees
+	uint8_t checksum; //makes the bytes of the record sum to zero
+} Calibration;
+
+extern Calibration calibration;
+
+void calibrationDefaults(void);
+
+char calibrationLoad(void);
+
+void calibrationSave(void);
+
+void calibrationReport(void);
+
+void calibrationEdit(void);
+
+#endif /* CALIBRATION_H */
\ No newline at end of file
@@ -0,0 +1,157 @@
+/*
+ * colorCalibration.c
+ *
+ * Created: 10/17/2026 5:03:21 PM
+ */ 
+
+#include <avr/io.h>
+#include <stdio.h>
+#include <string.h>
+#include "serial.h"
+#include "open_interface.h"
+#include "calibration.h"
+#include "colorCalibration.h"
+
+#define COLOR_SAMPLES 64 //sensor frames sampled per surface, about a second of streaming
+#define COLOR_TRIM 4 //samples ignored at each end of a histogram, so a stray frame can't move a threshold
+#define COLOR_BINS 64 //histogram bins, bin k holds signals from k*k up to (k+1)*(k+1) - 1
+#define COLOR_TIMEOUT_MS 100 //give up if no sensor frame arrives for this long
+
+#define SURFACE_FLOOR 0
+#define SURFACE_WHITE 1
+#define SURFACE_BLACK 2
+
+typedef struct { //the spread of each cliff signal over one surface
+	uint16_t low[COLOR_SENSORS];
+	uint16_t high[COLOR_SENSORS];
+} SurfaceRange;
+
+static const char *sensorNames[COLOR_SENSORS] = {"Left", "Front left", "Front right", "Right"};
+
+// Histogram bin of a cliff signal - bins widen with the signal, so dark surfaces still get fine bins
+static uint8_t colorBin(uint16_t signal) {
+	uint8_t bin = 0;
+	
+	while (bin < COLOR_BINS - 1 && (uint16_t) (bin + 1) * (bin + 1) <= signal) {
+		bin++;
+	}
+	return bin;
+}
+
+// Samples the cliff signals and finds the range each sensor reads, ignoring the extremes
+static char colorSample(oi_t *sensor, SurfaceRange *range) {
+	uint8_t histogram[COLOR_SENSORS][COLOR_BINS];
+	uint32_t lastFrame;
+	uint8_t samples = 0;
+	
+	memset(histogram, 0, sizeof(histogram));
+	oi_update(sensor);
+	lastFrame = sensor->frame_number;
+	while (samples < COLOR_SAMPLES) {
+		oi_update(sensor);
+		if (oi_is_stale(sensor, COLOR_TIMEOUT_MS)) {
+			return 0;
+		}
+		if (sensor->frame_number == lastFrame) {
+			continue;
+		}
+		lastFrame = sensor->frame_number;
+		histogram[0][colorBin(sensor->cliff_left_signal)]++;
+		histogram[1][colorBin(sensor->cliff_frontleft_signal)]++;
+		histogram[2][colorBin(sensor->cliff_frontright_signal)]++;
+		histogram[3][colorBin(sensor->cliff_right_signal)]++;
+		samples++;
+	}
+	
+	for (uint8_t i = 0; i < COLOR_SENSORS; i++) {
+		uint8_t count = 0;
+		uint8_t bin = 0;
+		
+		while ((count += histogram[i][bin]) <= COLOR_TRIM) { //lowest bin past the trimmed samples
+			bin++;
+		}
+		range->low[i] = (uint16_t) bin * bin;
+		while (count < COLOR_SAMPLES - COLOR_TRIM) { //highest bin before the trimmed samples
+			count += histogram[i][++bin];
+		}
+		range->high[i] = (uint16_t) (bin + 1) * (bin + 1) - 1;
+	}
+	return 1;
+}
+
+// Asks the operator to put the robot on a surface, then samples it
+static char colorSurface(oi_t *sensor, const char *surface, SurfaceRange *range) {
+	char prompt[96];
+	
+	sprintf(prompt, "Put all four cliff sensors over %s, then press enter (x skips).\n\r", surface);
+	serial_putString(prompt, strlen(prompt));
+	if (serial_getc() == 'x') {
+		return 0;
+	}
+	if (!colorSample(sensor, range)) {
+		serial_putString("No sensor data.\n\r", 17);
+		return 0;
+	}
+	return 1;
+}
+
+// Places the enter and release thresholds between two ranges, a quarter of the gap either side of its middle
+static char colorThreshold(const char *sensorName, const char *color, uint16_t below, uint16_t above, char tapeAbove, uint16_t *enter, uint16_t *release) {
+	char message[80];
+	
+	if (above <= below) {
+		sprintf(message, "%s sensor can't tell %s tape from the floor, kept.\n\r", sensorName, color);
+		serial_putString(message, strlen(message));
+		return 0;
+	}
+	uint16_t middle = below + (above - below) / 2;
+	uint16_t quarter = (above - below) / 4;
+	*enter = tapeAbove ? middle + quarter : middle - quarter;
+	*release = tapeAbove ? middle - quarter : middle + quarter;
+	sprintf(message, "%s %s: %u, release %u\n\r", sensorName, color, *enter, *release);
+	serial_putString(message, strlen(message));
+	return 1;
+}
+
+/// Measures the cliff signals over the floor, white tape and the black circle and sets the tape thresholds
+/**
+ * Guides the operator through the surfaces over serial. Each surface is sampled for about a second
+ * into a histogram per sensor; the thresholds go halfway between the floor and the tape, with a
+ * hysteresis band of half the gap. Sensors whose tape and floor overlap keep their old thresholds.
+ * The new thresholds are used immediately and kept across resets once the calibration is saved.
+ * @param *sensor the struct holding the robot's sensor data
+ * @return the number of thresholds changed, out of 8
+ */
+uint8_t colorCalibrate(oi_t *sensor) {
+	SurfaceRange ranges[3];
+	uint16_t *white[COLOR_SENSORS][2] = {
+		{&calibration.whiteLeft, &calibration.whiteLeftRelease},
+		{&calibration.whiteFrontLeft, &calibration.whiteFrontLeftRelease},
+		{&calibration.whiteFrontRight, &calibration.whiteFrontRightRelease},
+		{&calibration.whiteRight, &calibration.whiteRightRelease}
+	};
+	uint16_t *black[COLOR_SENSORS][2] = {
+		{&calibration.blackLeft, &calibration.blackLeftRelease},
+		{&calibration.blackFrontLeft, &calibration.blackFrontLeftRelease},
+		{&calibration.blackFrontRight, &calibration.blackFrontRightRelease},
+		{&calibration.blackRight, &calibration.blackRightRelease}
+	};
+	char haveWhite, haveBlack;
+	uint8_t changed = 0;
+	
+	if (!colorSurface(sensor, "plain floor", &ranges[SURFACE_FLOOR])) {
+		return 0; //both thresholds are measured against the floor
+	}
+	haveWhite = colorSurface(sensor, "white tape", &ranges[SURFACE_WHITE]);
+	haveBlack = colorSurface(sensor, "the black circle", &ranges[SURFACE_BLACK]);
+	
+	for (uint8_t i = 0; i < COLOR_SENSORS; i++) {
+		if (haveWhite) {
+			changed += colorThreshold(sensorNames[i], "white", ranges[SURFACE_FLOOR].high[i], ranges[SURFACE_WHITE].low[i], 1, white[i][0], white[i][1]);
+		}
+		if (haveBlack) {
+			changed += colorThreshold(sensorNames[i], "black", ranges[SURFACE_BLACK].high[i], ranges[SURFACE_FLOOR].low[i], 0, black[i][0], black[i][1]);
+		}
+	}
+	return changed;
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+/*
+ * colorCalibration.h
+ *
+ * Created: 10/17/2026 5:03:44 PM
+ */ 
+
+#ifndef COLORCALIBRATION_H
+#define COLORCALIBRATION_H
+
+#include "open_interface.h"
+
+#define COLOR_SENSORS 4 //cliff signals in calibration order: left, front left, front right, right
+
+uint8_t colorCalibrate(oi_t *sensor);
+
+#endif /* COLORCALIBRATION_H */
\ No newline at end of file
@@ -0,0 +1,177 @@
+/*
+ * grid.c
+ *
+ * Created: 10/17/2026 8:04:33 PM
+ */ 
+
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "serial.h"
+#include "pose.h"
+#include "segment.h"
+#include "grid.h"
+
+static uint8_t grid[GRID_SIZE * GRID_SIZE / 4]; //four cells per byte, gridClear must run before the first use
+
+static const char cellChars[4] = {'.', '?', 'o', '#'}; //how gridDump shows each cell value
+
+// Cell column or row holding a coordinate in mm, outside 0 to GRID_SIZE - 1 if it is off the map
+static int gridCell(int32_t mm) {
+	int32_t offset = mm + (int32_t) GRID_SIZE / 2 * GRID_CELL_MM;
+	
+	return (offset < 0) ? -1 : offset / GRID_CELL_MM; //rounded down either way
+}
+
+// Whether a cell is on the map
+static char gridOnMap(int cx, int cy) {
+	return cx >= 0 && cy >= 0 && cx < GRID_SIZE && cy < GRID_SIZE;
+}
+
+// Moves a cell's log-odds one step toward occupied or free, saturating at either end
+static void gridUpdate(int cx, int cy, char hit) {
+	uint16_t index = (uint16_t) cy * GRID_SIZE + cx;
+	uint8_t shift = (index & 3) * 2;
+	uint8_t value = (grid[index >> 2] >> shift) & 3;
+	
+	if (hit && value < GRID_OCCUPIED) {
+		value++;
+	}
+	else if (!hit && value > GRID_FREE) {
+		value--;
+	}
+	grid[index >> 2] = (grid[index >> 2] & ~(3 << shift)) | (value << shift);
+}
+
+/// Forgets the map
+/**
+ * Every cell goes back to unknown - call at startup and when the pose is reset, since the map is kept in the pose's frame
+ */
+void gridClear(void) {
+	memset(grid, 0x55, sizeof(grid));
+}
+
+/// Value of one cell
+/**
+ * @param cx column, counting forward (+x) from the back edge of the map - the origin is in column GRID_SIZE / 2
+ * @param cy row, counting left (+y) from the right edge of the map - the origin is in row GRID_SIZE / 2
+ * @return GRID_FREE to GRID_OCCUPIED, GRID_UNKNOWN for cells off the map
+ */
+uint8_t gridGet(int cx, int cy) {
+	uint16_t index = (uint16_t) cy * GRID_SIZE + cx;
+	
+	if (!gridOnMap(cx, cy)) {
+		return GRID_UNKNOWN;
+	}
+	return (grid[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+/// Adds one range reading to the map
+/**
+ * Walks the cells from the robot to the end of the beam (Bresenham's line), marking the cells it passes through
+ * as more likely free, and the last one as more likely occupied if the beam hit something there. A beam leaving
+ * the map is followed to the edge.
+ * @param p the robot's pose when the reading was taken
+ * @param bearing direction of the beam, degrees counterclockwise from the robot's heading
+ * @param rangeCm length of the beam
+ * @param hit whether the beam ended on something, rather than at the end of the sensor's range
+ */
+void gridBeam(const Pose *p, int bearing, int rangeCm, char hit) {
+	uint32_t direction = p->theta + (int32_t) bearing * BINARY_DEGREE;
+	int32_t x = p->x >> 8; //mm
+	int32_t y = p->y >> 8;
+	int cx = gridCell(x);
+	int cy = gridCell(y);
+	int ex = gridCell(x + (((int32_t) rangeCm * 10 * poseCos(direction)) >> 14)); //cell the beam ends in
+	int ey = gridCell(y + (((int32_t) rangeCm * 10 * poseSin(direction)) >> 14));
+	int dx = abs(ex - cx);
+	int dy = -abs(ey - cy);
+	int sx = (cx < ex) ? 1 : -1;
+	int sy = (cy < ey) ? 1 : -1;
+	int error = dx + dy;
+	
+	while (cx != ex || cy != ey) {
+		if (!gridOnMap(cx, cy)) {
+			return; //a straight beam doesn't come back once it leaves
+		}
+		gridUpdate(cx, cy, 0);
+		int twice = 2 * error;
+		if (twice >= dy) {
+			error += dy;
+			cx += sx;
+		}
+		if (twice <= dx) {
+			error += dx;
+			cy += sy;
+		}
+	}
+	if (gridOnMap(ex, ey)) {
+		gridUpdate(ex, ey, hit);
+	}
+}
+
+/// Adds one scan step to the map at the current pose
+/**
+ * Something the IR sensor sees within SEGMENT_START_CM is a hit, placed at the ping distance when both sensors
+ * agree since the ping sensor is more precise at range. Otherwise the IR sensor's beam is free up to that range -
+ * it can't be trusted further out.
+ * @param degree servo position, 90 straight ahead
+ * @param irCm IR distance of the step in cm
+ * @param pingCm ping distance of the step in cm, -1 if the step wasn't pinged - only used when irCm is under
+ * SEGMENT_START_CM, which the scans ping
+ */
+void gridScanStep(int degree, int irCm, int pingCm) {
+	Pose p;
+	
+	poseGet(&p);
+	if (irCm < SEGMENT_START_CM) {
+		gridBeam(&p, degree - 90, (abs(irCm - pingCm) <= SEGMENT_AGREE_CM) ? pingCm : irCm, 1);
+	}
+	else {
+		gridBeam(&p, degree - 90, SEGMENT_START_CM, 0);
+	}
+}
+
+// Character gridDump shows for a cell
+static char gridChar(int cx, int cy, int robotX, int robotY) {
+	return (cx == robotX && cy == robotY) ? 'R' : cellChars[gridGet(cx, cy)];
+}
+
+/// Sends the map over serial, run-length encoded
+/**
+ * One line per row, from the map's left (+y) edge down, each from the back (-x) edge forward, with a character
+ * per cell: . free, ? unknown, o likely occupied, # occupied and R for the robot. Runs of the same character are
+ * sent as the run's length followed by the character, so "12?3.#" is 12 unknown cells, 3 free ones and an
+ * occupied one - an empty map is 64 lines of "64?".
+ */
+void gridDump(void) {
+	char line[GRID_SIZE + 8];
+	Pose p;
+	int robotX, robotY;
+	
+	poseGet(&p);
+	robotX = gridCell(p.x >> 8);
+	robotY = gridCell(p.y >> 8);
+	sprintf(line, "Map %dx%d, %d mm cells\n\r", GRID_SIZE, GRID_SIZE, GRID_CELL_MM);
+	serial_putString(line, strlen(line));
+	for (int cy = GRID_SIZE - 1; cy >= 0; cy--) {
+		uint8_t length = 0;
+		int cx = 0;
+		while (cx < GRID_SIZE) {
+			char cell = gridChar(cx, cy, robotX, robotY);
+			int run = 1;
+			while (cx + run < GRID_SIZE && gridChar(cx + run, cy, robotX, robotY) == cell) {
+				run++;
+			}
+			if (run > 1) { //runs never take more characters than cells, so a line fits
+				length += sprintf(line + length, "%d", run);
+			}
+			line[length++] = cell;
+			cx += run;
+		}
+		line[length++] = '\n';
+		line[length++] = '\r';
+		serial_putString(line, length);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+/*
+ * grid.h
+ *
+ * Created: 10/17/2026 8:04:51 PM
+ */ 
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdint.h>
+#include "pose.h"
+
+#define GRID_SIZE 64 //cells along each side, 1 KB at 2 bits per cell - the pose origin is in the middle
+#define GRID_CELL_MM 100 //edge of a cell, so the map covers 6.4 m square
+
+#define GRID_FREE 0 //cell values: 2-bit saturating log-odds of the cell being occupied
+#define GRID_UNKNOWN 1 //what every cell starts at
+#define GRID_LIKELY 2
+#define GRID_OCCUPIED 3
+
+void gridClear(void);
+
+uint8_t gridGet(int cx, int cy);
+
+void gridBeam(const Pose *p, int bearing, int rangeCm, char hit);
+
+void gridScanStep(int degree, int irCm, int pingCm);
+
+void gridDump(void);
+
+#endif /* GRID_H */
\ No newline at end of file
@@ -0,0 +1,167 @@
+/*
+ * hazard.c
+ *
+ * Created: 10/17/2026 2:39:48 PM
+ */ 
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include "serial.h"
+#include "open_interface.h"
+#include "hazard.h"
+#include "calibration.h"
+
+//which cliff sensor sees which tape: white in the low four bits, black in the high four,
+//each in the order left, front left, front right, right
+#define SEEN_WHITE(n) (0x01 << (n))
+#define SEEN_BLACK(n) (0x10 << (n))
+
+//tape thresholds from the robot's calibration, with hysteresis per sensor - a sensor already on the tape uses the release threshold
+#define WHITE(sensor, n) ((seen & SEEN_WHITE(n)) ? calibration.white##sensor##Release : calibration.white##sensor)
+#define BLACK(sensor, n) ((seen & SEEN_BLACK(n)) ? calibration.black##sensor##Release : calibration.black##sensor)
+
+//the rule table: RULE(sensor field, comparison, threshold, hazard bit, tape bit of the sensor)
+//expanded into straight-line comparisons
+#define HAZARD_RULES(RULE) \
+	RULE(cliff_left,              !=, 0,                    HAZARD_CLIFF_LEFT,       0) \
+	RULE(cliff_frontleft,         !=, 0,                    HAZARD_CLIFF_FRONTLEFT,  0) \
+	RULE(cliff_frontright,        !=, 0,                    HAZARD_CLIFF_FRONTRIGHT, 0) \
+	RULE(cliff_right,             !=, 0,                    HAZARD_CLIFF_RIGHT,      0) \
+	RULE(wheeldrop_left,          !=, 0,                    HAZARD_WHEEL_DROP,       0) \
+	RULE(wheeldrop_right,         !=, 0,                    HAZARD_WHEEL_DROP,       0) \
+	RULE(wheeldrop_caster,        !=, 0,                    HAZARD_WHEEL_DROP,       0) \
+	RULE(bumper_left,             !=, 0,                    HAZARD_BUMP_LEFT,        0) \
+	RULE(bumper_right,            !=, 0,                    HAZARD_BUMP_RIGHT,       0) \
+	RULE(cliff_frontleft_signal,  >,  WHITE(FrontLeft, 1),  HAZARD_WHITE_TAPE,       SEEN_WHITE(1)) \
+	RULE(cliff_left_signal,       >,  WHITE(Left, 0),       HAZARD_WHITE_TAPE,       SEEN_WHITE(0)) \
+	RULE(cliff_right_signal,      >,  WHITE(Right, 3),      HAZARD_WHITE_TAPE,       SEEN_WHITE(3)) \
+	RULE(cliff_frontright_signal, >,  WHITE(FrontRight, 2), HAZARD_WHITE_TAPE,       SEEN_WHITE(2)) \
+	RULE(cliff_frontleft_signal,  <,  BLACK(FrontLeft, 1),  HAZARD_BLACK_TAPE,       SEEN_BLACK(1)) \
+	RULE(cliff_left_signal,       <,  BLACK(Left, 0),       HAZARD_BLACK_TAPE,       SEEN_BLACK(0)) \
+	RULE(cliff_right_signal,      <,  BLACK(Right, 3),      HAZARD_BLACK_TAPE,       SEEN_BLACK(3)) \
+	RULE(cliff_frontright_signal, <,  BLACK(FrontRight, 2), HAZARD_BLACK_TAPE,       SEEN_BLACK(2))
+
+#define HAZARD_TEST(field, comparison, threshold, hazard, tape) \
+	if (frame->field comparison threshold) { \
+		mask |= hazard; \
+		sensors |= tape; \
+	}
+
+static volatile uint16_t hazardArmed = 0; //hazards that stop the wheels as soon as they are seen
+static volatile uint16_t hazardLatest = 0; //hazards in the most recent frame
+static volatile uint8_t hazardTapeSeen = 0; //SEEN_WHITE and SEEN_BLACK bits of the sensors on tape in the most recent frame
+static volatile uint16_t hazardStop = 0; //hazards that stopped the wheels, until cleared
+
+static const char *hazardMessages[HAZARD_COUNT] = {
+	"Left cliff sensor triggered.\n\r",
+	"Front left cliff sensor triggered.\n\r",
+	"Front right cliff sensor triggered.\n\r",
+	"Right cliff sensor triggered.\n\r",
+	"Wheel drop detected.\n\r",
+	"Left bumper triggered.\n\r",
+	"Right bumper triggered.\n\r",
+	"White tape detected.\n\r",
+	"Black tape detected!\n\r"
+};
+
+//Evaluates the rule table, and sets *tape to the SEEN_WHITE and SEEN_BLACK bits of the sensors on tape
+static uint16_t hazardCheck(const oi_t *frame, uint8_t *tape) {
+	uint16_t mask = 0;
+	uint8_t sensors = 0;
+	uint8_t seen = hazardTapeSeen;
+	
+	HAZARD_RULES(HAZARD_TEST)
+	if (mask & HAZARD_CLIFFS) {
+		mask &= ~HAZARD_TAPE; //cliff signals over a drop say nothing about the floor color
+		sensors = 0;
+	}
+	*tape = sensors;
+	return mask;
+}
+
+/// Evaluates the rule table against one sensor frame
+/**
+ * A cliff sensor that was on tape in the last frame given to hazardUpdate keeps seeing it until its own
+ * signal crosses its release threshold, so a signal hovering at a threshold doesn't flicker in and out.
+ * The other sensors still need their full threshold.
+ * @param *frame the sensor data to check
+ * @return a bitmask of every hazard in the frame
+ */
+uint16_t hazardEvaluate(const oi_t *frame) {
+	uint8_t tape;
+	
+	return hazardCheck(frame, &tape);
+}
+
+/// Checks a new sensor frame and stops the wheels on an armed hazard
+/**
+ * Called by the frame parser for every frame, possibly from the USART interrupt, so the robot stops
+ * within one sensor frame even while the main loop is blocked. It also sets the stop flag, which makes
+ * motionUpdate drop the queued commands on its next call.
+ * @param *frame the newly decoded sensor frame
+ */
+void hazardUpdate(const oi_t *frame) {
+	static const uint8_t stop[] = {OI_OPCODE_DRIVE_WHEELS, 0, 0, 0, 0};
+	uint8_t tape;
+	uint16_t mask = hazardCheck(frame, &tape);
+	
+	hazardLatest = mask;
+	hazardTapeSeen = tape;
+	if ((mask & hazardArmed) && hazardStop == 0) {
+		hazardStop = mask & hazardArmed;
+		oi_command_try_tx(stop, sizeof(stop)); //never waits; if the queue is full the motion engine stops on its next call
+	}
+}
+
+/// Selects the hazards that stop the wheels
+/**
+ * @param mask hazard bits to act on, 0 to only watch
+ */
+void hazardArm(uint16_t mask) {
+	hazardArmed = mask;
+}
+
+/// Hazards in the most recent sensor frame
+uint16_t hazardActive(void) {
+	return hazardLatest;
+}
+
+/// Hazards that stopped the wheels since the last hazardClear(), 0 if none
+uint16_t hazardTripped(void) {
+	return hazardStop;
+}
+
+/// Forgets the hazards that stopped the wheels so armed hazards can stop them again
+void hazardClear(void) {
+	hazardStop = 0;
+}
+
+/// The highest-priority hazard in a mask
+/**
+ * @param mask hazard bits
+ * @return the index of the highest-priority hazard, HAZARD_COUNT if the mask is empty
+ */
+uint8_t hazardReason(uint16_t mask) {
+	uint8_t reason = 0;
+	
+	while (reason < HAZARD_COUNT && !(mask & (1 << reason))) {
+		reason++;
+	}
+	return reason;
+}
+
+/// Sends the highest-priority hazard in a mask over serial
+/**
+ * @param mask hazard bits, nothing is sent if it is empty
+ */
+void hazardReport(uint16_t mask) {
+	uint8_t reason = hazardReason(mask);
+	
+	if ((mask & HAZARD_BUMPERS) == HAZARD_BUMPERS && reason == hazardReason(HAZARD_BUMP_LEFT)) {
+		serial_putString("Both bumpers triggered.\n\r", 26);
+	}
+	else if (reason < HAZARD_COUNT) {
+		serial_putString((char *) hazardMessages[reason], strlen(hazardMessages[reason]));
+	}
+}
\ No newline at end of file
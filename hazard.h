@@ -0,0 +1,46 @@
+/*
+ * hazard.h
+ *
+ * Created: 10/17/2026 2:40:11 PM
+ */ 
+
+#ifndef HAZARD_H
+#define HAZARD_H
+
+#include <inttypes.h>
+#include "open_interface.h"
+
+//hazard bits, highest priority first - the lowest set bit is the stop reason
+#define HAZARD_CLIFF_LEFT       0x0001
+#define HAZARD_CLIFF_FRONTLEFT  0x0002
+#define HAZARD_CLIFF_FRONTRIGHT 0x0004
+#define HAZARD_CLIFF_RIGHT      0x0008
+#define HAZARD_WHEEL_DROP       0x0010
+#define HAZARD_BUMP_LEFT        0x0020
+#define HAZARD_BUMP_RIGHT       0x0040
+#define HAZARD_WHITE_TAPE       0x0080
+#define HAZARD_BLACK_TAPE       0x0100
+#define HAZARD_COUNT 9 //number of hazard bits, also the reason reported when there is no hazard
+
+#define HAZARD_CLIFFS (HAZARD_CLIFF_LEFT | HAZARD_CLIFF_FRONTLEFT | HAZARD_CLIFF_FRONTRIGHT | HAZARD_CLIFF_RIGHT)
+#define HAZARD_BUMPERS (HAZARD_BUMP_LEFT | HAZARD_BUMP_RIGHT)
+#define HAZARD_TAPE (HAZARD_WHITE_TAPE | HAZARD_BLACK_TAPE)
+#define HAZARD_ALL 0x01FF
+
+uint16_t hazardEvaluate(const oi_t *frame);
+
+void hazardUpdate(const oi_t *frame);
+
+void hazardArm(uint16_t mask);
+
+uint16_t hazardActive(void);
+
+uint16_t hazardTripped(void);
+
+void hazardClear(void);
+
+uint8_t hazardReason(uint16_t mask);
+
+void hazardReport(uint16_t mask);
+
+#endif /* HAZARD_H */
\ No newline at end of file
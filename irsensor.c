@@ -6,54 +6,206 @@
  */ 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "util.h"
+#include "irsensor.h"
+
+#define IR_CHANNEL 2 //ADC channel of the IR sensor
+#define IR_WINDOW 16 //latest conversions the filter looks at, 1.7 ms worth at 104 us each
+#define IR_TRIM 6 //smallest and largest conversions in the window the filter ignores
+
+static volatile uint16_t irRing[IR_WINDOW]; //latest conversions in arrival order, oldest at irHead
+static volatile uint8_t irHead; //next slot of irRing to overwrite
+static volatile uint8_t irFresh; //conversions since irSampleStart, stops counting at IR_WINDOW
+static volatile char adcBorrowed; //ADC_read is using the ADC, the sampler ignores its conversions
+
+//IR distance in cm for every ADC reading: 2364.5 * reading^-0.888, limited to 255 cm (calibration for robot 4)
+static const uint8_t irDistanceTable[1024] PROGMEM = {
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 242, 226, 213,
+	201, 191, 181, 173, 165, 158, 151, 146, 140, 135, 130, 126, 122, 118, 115, 112,
+	108, 105, 103, 100, 98, 95, 93, 91, 89, 87, 85, 83, 82, 80, 78, 77,
+	75, 74, 73, 72, 70, 69, 68, 67, 66, 65, 64, 63, 62, 61, 60, 59,
+	58, 58, 57, 56, 55, 55, 54, 53, 53, 52, 51, 51, 50, 49, 49, 48,
+	48, 47, 47, 46, 46, 45, 45, 44, 44, 43, 43, 43, 42, 42, 41, 41,
+	41, 40, 40, 39, 39, 39, 38, 38, 38, 37, 37, 37, 36, 36, 36, 36,
+	35, 35, 35, 34, 34, 34, 34, 33, 33, 33, 33, 32, 32, 32, 32, 32,
+	31, 31, 31, 31, 30, 30, 30, 30, 30, 29, 29, 29, 29, 29, 29, 28,
+	28, 28, 28, 28, 27, 27, 27, 27, 27, 27, 26, 26, 26, 26, 26, 26,
+	26, 25, 25, 25, 25, 25, 25, 25, 24, 24, 24, 24, 24, 24, 24, 24,
+	23, 23, 23, 23, 23, 23, 23, 23, 23, 22, 22, 22, 22, 22, 22, 22,
+	22, 22, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 20, 20, 20,
+	20, 20, 20, 20, 20, 20, 20, 20, 19, 19, 19, 19, 19, 19, 19, 19,
+	19, 19, 19, 19, 19, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18,
+	18, 18, 18, 18, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+	17, 17, 17, 17, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+	16, 16, 16, 16, 16, 16, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 14, 14, 14, 14, 14,
+	14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+	14, 14, 14, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+	13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+	11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+	11, 11, 11, 11, 11, 11, 11, 11, 10, 10, 10, 10, 10, 10, 10, 10,
+	10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+	10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+	10, 10, 10, 10, 10, 10, 10, 10, 9, 9, 9, 9, 9, 9, 9, 9,
+	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+	9, 9, 9, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5
+};
+
+/// Converts an IR sensor reading to a distance
+/**
+ * Looks the reading up in the calibration table instead of evaluating the calibration curve
+ * @param quantization the ADC reading, 0 to 1023
+ * @return distance from the sensor in cm, at most 255
+ */
+int irDistance(int quantization) {
+	return pgm_read_byte(&irDistanceTable[quantization & 0x3FF]);
+}
+
+/// Files each free-running IR conversion into the filter window
+/**
+ * Only overwrites the oldest conversion in the ring, so the interrupt takes the same few cycles every 104 us
+ * conversion however large the window is; irFiltered sorts the window when it is asked for a reading
+ */
+ISR(ADC_vect) {
+	if (adcBorrowed) {
+		return;
+	}
+	irRing[irHead] = ADC;
+	irHead = (irHead + 1) % IR_WINDOW;
+	if (irFresh < IR_WINDOW) {
+		irFresh++;
+	}
+}
 
 /// Reads one set of data from the ADC
 /**
- * Takes data from the ADC using the given channel.
+ * Takes data from the ADC using the given channel. The IR sampler pauses for the conversion and restarts afterwards.
  * @param channel the channel from which to read the ADC data
  */
 int ADC_read(char channel) {
-	ADMUX |= (channel & 0x1F); //select channel to read from ADC
+	int result;
+	char sampling = (ADCSRA & _BV(ADFR)) != 0;
+	
+	adcBorrowed = 1;
+	ADCSRA &= ~_BV(ADFR); //let the sampler's conversion finish and stop there
+	while (ADCSRA & _BV(ADSC));
+	ADMUX = (ADMUX & 0xE0) | (channel & 0x1F); //select channel to read from ADC, clearing the last one
 	ADCSRA |= _BV(ADSC); //start ADC read transfer
 	while (ADCSRA & _BV(ADSC)); //while transfer is available
-	return ADC; //read from ADC
+	result = ADC; //read from ADC
+	ADMUX = (ADMUX & 0xE0) | IR_CHANNEL;
+	if (sampling) {
+		ADCSRA |= _BV(ADFR) | _BV(ADSC);
+	}
+	adcBorrowed = 0;
+	return result;
 }
 
-/// Gets the average of 30 sensor results
+/// Gets the filtered IR reading once the filter holds only new conversions
 /** 
- * Takes 30 data points from the sensor and averages them, eliminating outliers within a specific tolerance
- * @return the average of 30 results as an int
- */
-int avgSensorResults() { //get the average of 30 sensor readings to reduce "jitter"
-	int resultTotal = 0;
-	int finalTotal = 0;
-	int results[30];
-	int toleranceH = 0;
-	int toleranceL = 0;
-	for (int i = 0; i < 30; i++) {
-		results[i] = ADC_read(2); //read from ADC channel 2 (IR sensor)
-		resultTotal += ADC_read(2);
+ * Waits 1.7 ms for a full window of conversions taken after the call, for callers that just moved the sensor
+ * @return the filtered ADC reading as an int
+ */
+int avgSensorResults() { //filtered to reduce "jitter"
+	irSampleStart();
+	while (!irSamplePoll());
+	return irFiltered();
+}
+
+/// Filtered IR reading, without waiting for the ADC
+/**
+ * Mean of the middle IR_WINDOW - 2 * IR_TRIM of the latest IR_WINDOW conversions, so a few wild conversions
+ * on either side are ignored like a median would, while the rest still average out the noise. Copies the
+ * window with interrupts off and sorts the copy with them on, an insertion sort of IR_WINDOW conversions.
+ * @return the filtered ADC reading, 0 to 1023
+ */
+int irFiltered() {
+	uint16_t sorted[IR_WINDOW];
+	uint16_t total = 0;
+	uint8_t interrupts = SREG;
+	
+	cli(); //the window must not change halfway through the copy
+	for (uint8_t i = 0; i < IR_WINDOW; i++) {
+		sorted[i] = irRing[i];
 	}
-	toleranceH = (resultTotal/30)+10;
-	toleranceL = (resultTotal/30)-10;
-	for (int j = 0; j < 30; j++) {
-		if (results[j] > toleranceH || results[j] < toleranceL) {
-			results[j] = (resultTotal/30);			
+	SREG = interrupts;
+	for (uint8_t i = 1; i < IR_WINDOW; i++) {
+		uint16_t sample = sorted[i];
+		uint8_t j = i;
+		while (j > 0 && sorted[j - 1] > sample) { //slide larger conversions up to make room
+			sorted[j] = sorted[j - 1];
+			j--;
 		}
-		finalTotal += results[j];
+		sorted[j] = sample;
+	}
+	for (uint8_t i = IR_TRIM; i < IR_WINDOW - IR_TRIM; i++) {
+		total += sorted[i];
 	}
-	return finalTotal/30;
+	return total / (IR_WINDOW - 2 * IR_TRIM);
+}
+
+/// Starts counting conversions for irSamplePoll
+/**
+ * For callers that must not use conversions from before some point, e.g. before the sensor moved
+ */
+void irSampleStart() {
+	irFresh = 0;
+}
+
+/// Whether the filter window has been refilled since irSampleStart
+/**
+ * Never waits for the ADC, so it can be called while waiting for something else
+ * @return 1 once IR_WINDOW conversions have arrived since irSampleStart
+ */
+char irSamplePoll() {
+	return irFresh >= IR_WINDOW;
 }
 
 /// Initialize the ADC
 /**
- * Prepares the ADC for use by the program, setting prescalar values, transfer modes, etc.
- * 
+ * Prepares the ADC for use by the program, setting prescalar values, transfer modes, etc., and starts converting
+ * the IR sensor continuously - each conversion interrupts to update the filter behind irFiltered
  */
 void ADC_init() {
-	ADMUX = _BV(REFS1) | _BV(REFS0);
-	ADCSRA = _BV(ADEN) | (7<<ADPS0);
+	ADMUX = _BV(REFS1) | _BV(REFS0) | IR_CHANNEL;
+	ADCSRA = _BV(ADEN) | _BV(ADFR) | _BV(ADIE) | (7<<ADPS0);
 	//ADCSRA = 0b10100111; - last three bits divide frequency by 128 - results in 125kHz
+	ADCSRA |= _BV(ADSC); //first conversion, free running mode starts the rest
 }
 
@@ -9,4 +9,12 @@ int avgSensorResults(void);
 
 void ADC_init(void);
 
-int ADC_read(char channel);
\ No newline at end of file
+int ADC_read(char channel);
+
+int irDistance(int quantization);
+
+int irFiltered(void);
+
+void irSampleStart(void);
+
+char irSamplePoll(void);
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <avr/io.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include "util.h"
 #include "lcd.h"
@@ -17,274 +17,434 @@
 #include "open_interface.h"
 #include "movement.h"
 #include "remoteControl.h"
+#include "hazard.h"
+#include "pose.h"
 
-int rotationCalibration = 13; //calibration for the rotation values - robot #4 specifically
-int colorFlag = 0; //whether or not colored tape has been detected
-int bumperFlag = 0;
-int cliffFlag = 0;
+#define SENSOR_TIMEOUT_MS 100 //stop driving if no sensor frame has arrived for this long
+#define CONTROL_RATE_HZ 50 //default rate of the motion control loop
+#define MAX_SPEED 500 //fastest wheel speed the Create accepts, mm/s
+#define REVERSE_SPEED 200 //backing up is blind, so keep it slower
+#define MIN_SPEED 20 //slowest speed of a profile, so it always reaches its target
+#define ACCELERATION 1000 //profile acceleration and deceleration, mm/s^2
+#define ARC_PER_1000_DEGREES 2251 //wheel travel in mm for 1000 degrees of rotation in place (258 mm wheel base)
+#define HALF_WHEEL_BASE 129 //distance from the center of the robot to each wheel, mm
+#define GOTO_MAX_ARC_ANGLE 0x2AAA //targets more than 60 degrees off the heading are turned toward first (binary angle)
+#define HEADING_TRIM_LIMIT 100 //largest steering correction, mm/s
+#define HEADING_INTEGRAL_LIMIT 400 //keeps the integral from winding up, degree-periods
 
+unsigned int controlPeriod = 1000 / CONTROL_RATE_HZ; //control loop period in milliseconds
 
-/// Checks cliff sensors 
+//sensor packets streamed for translations, arcs and while idle - bumpers, cliff flags, distance, angle and cliff
+//signals, which the hazard rules, heading hold, odometry and the coast after a stop all need
+static const uint8_t drivePackets[] = {7, 9, 10, 11, 12, 19, 20, 28, 29, 30, 31};
+//sensor packets streamed for rotations - turning in place the distance stays at zero, so it is left out
+static const uint8_t rotatePackets[] = {7, 9, 10, 11, 12, 20, 28, 29, 30, 31};
+
+//motion commands waiting to run, the first one is running
+static MotionCommand motionQueue[MOTION_QUEUE_SIZE];
+static uint8_t motionHead = 0;
+static uint8_t motionCount = 0;
+static char motionActive = 0; //whether the wheels are being driven
+static long motionProgress = 0; //distance or angle covered by the running command
+static int motionSpeed = 0; //wheel speed commanded in the last control period
+static unsigned long motionNextTick; //when the next control period starts
+
+//heading hold for translations, gains in 1/16 mm/s of wheel speed difference per degree
+static char headingHold = 1;
+static int headingKp = 64;
+static int headingKi = 4;
+static int headingKd = 0;
+static uint8_t motionLastType = MOTION_ROTATE; //type of the last command that ran
+static int motionHeading = 0; //degrees turned since the straight line started, counterclockwise positive
+static int headingIntegral = 0;
+static int headingLastError = 0;
+
+
+/// Set the rate of the motion control loop
 /**
- * Checks to ensure that no cliff is currently being detected by cliff sensors
- * @param *sensor_data the struct holding the robot's sensor data
+ * Sets how often the drive loops read the sensors and update the wheel speeds
+ * @param hz control loop rate, 1 to 66 (the sensor stream arrives every 15 ms)
  */
-void checkSensors(oi_t *sensor_data) { //TODO
-	if (!sensor_data->cliff_frontleft && !sensor_data->cliff_left && !sensor_data->cliff_right && !sensor_data->cliff_frontright) { //no cliffs detected
-		//do nothing
-		cliffFlag = 0;
-	}
-	if (sensor_data->cliff_frontleft) { //front left cliff
-		colorFlag = 0; //color data becomes unreliable, remove color flags
-		cliffFlag = 2;
-	}
-	if (sensor_data->cliff_left) { //left cliff
-		colorFlag = 0;
-		cliffFlag = 1;
-	}
-	if (sensor_data->cliff_right) { //right cliff
-		colorFlag = 0;
-		cliffFlag = 4;
-	}
-	if (sensor_data->cliff_frontright) { //front right cliff
-		colorFlag = 0;
-		cliffFlag = 3;
-	}
-	
+void setControlRate(unsigned int hz) {
+	if (hz < 1) {
+		hz = 1;
+	}
+	if (hz > 66) {
+		hz = 66;
+	}
+	controlPeriod = 1000 / hz;
 }
 
-/// Move the robot backwards one distance increment
+
+/// Speed for the next control period of a trapezoidal profile
 /**
- * Sets the robot's wheels to move backwards for a specified distance, updating sensors after each degree of wheel rotation
- * @param *sensor the struct holding the robot's sensor data
- * @param cm the distance to move
+ * Accelerates from the current speed, cruises at the maximum speed and decelerates so that the
+ * robot stops at the target
+ * @param speed the wheel speed commanded in the last period, mm/s
+ * @param remaining wheel travel left to the target, mm
+ * @param maxSpeed cruising speed, mm/s
+ * @return the wheel speed to command, mm/s
  */
-void moveBackward(oi_t *sensor, int cm) {
-	if (cm != 0) {
-		oi_set_wheels(-100, -100); //set wheels to move backwards
-	
-		int totalDistance = 0; //keep track of total distance traveled
+static int profileSpeed(int speed, long remaining, int maxSpeed) {
+	long next = speed + (long) ACCELERATION * controlPeriod / 1000; //accelerate
+	long stopping = poseSqrt(2UL * ACCELERATION * remaining); //fastest speed that still stops in time
 	
-		while(totalDistance >= cm*10) {
-			oi_update(sensor); //update all sensors
-			totalDistance += sensor->distance;
-		}
+	if (next > maxSpeed) {
+		next = maxSpeed;
+	}
+	if (next > stopping) {
+		next = stopping;
+	}
+	if (next < MIN_SPEED) {
+		next = MIN_SPEED;
 	}
-	oi_set_wheels(0,0); //stop motion
-	colorFlag = 0;
-	bumperFlag = 0;
-	cliffFlag = 0;
+	return next;
 }
 
-/// Checks for any colored tape below cliff sensors
-/**
- * Checks to see what the color of the ground is using the cliff sensors (Black, Grey, or White)
- * @param frontLeft the second cliff sensor from the left's sensor signal
- * @param left the first cliff sensor from the left's sensor signal
- * @param right the fourth cliff sensor from the left's sensor signal
- * @param frontRight the third cliff sensor from the left's sensor signal
- */
-void colorCheck(int frontLeft, int left, int right, int frontRight) {
-	if (frontLeft > 125 || left > 645 || right > 1324 || frontRight > 1030) { //white tape values
-		colorFlag = 1;
+// Streams the sensor packets a command reads, or the drive set when command is NULL
+static void motionPackets(const MotionCommand *command) {
+	if (command != NULL && command->type == MOTION_ROTATE) {
+		oi_set_packets(rotatePackets, sizeof(rotatePackets));
 	}
-	else if (frontLeft < 22 || left < 66 || right < 152 || frontRight < 118) { //black circle values
-		colorFlag = 2;
-		//play celebration song
+	else {
+		oi_set_packets(drivePackets, sizeof(drivePackets)); //nothing is sent if it is already registered
 	}
 }
 
-/// Checks for any objects detected by bump sensors
-/**
- * Checks bump sensors to ensure that the robot has not collided with any objects in the field
- * @param *sensor_data the struct holding the robot's sensor data
- * @param leftBumper the status of the left bump sensor
- * @param rightBumper the status of the right bump sensor
- */
-void bumperCheck(oi_t *sensor_data, int leftBumper, int rightBumper) { //TODO
-	bumperFlag = 0;
-	if (leftBumper == 1 && rightBumper == 0) { //just the left bumper is triggered
-		bumperFlag = 1;
+/// Stop moving, report why and drop the queued commands
+static void motionHalt(oi_t *sensor) {
+	oi_set_wheels(0,0);
+	motionActive = 0;
+	motionCount = 0;
+	hazardArm(0);
+	motionPackets(NULL);
+	
+	if (oi_is_stale(sensor, SENSOR_TIMEOUT_MS)) {
+		serial_putString("Sensor data lost, stopped.\n\r", 29);
 	}
-	else if (rightBumper == 1 && leftBumper == 0) { //just the right bumper is triggered
-		bumperFlag = 2;
+	hazardReport(hazardTripped());
+	hazardClear();
+}
+
+// The queued command n places after the running one
+static MotionCommand *motionAt(uint8_t n) {
+	return &motionQueue[(motionHead + n) % MOTION_QUEUE_SIZE];
+}
+
+// Whether a command continues the previous one in the same direction, so the robot need not slow down between them
+static char motionBlends(const MotionCommand *previous, const MotionCommand *next) {
+	return previous->type == next->type &&
+			previous->radius == next->radius &&
+			(previous->value < 0) == (next->value < 0);
+}
+
+// Whether the running command has covered its distance or angle
+static char motionDone(void) {
+	MotionCommand *command = motionAt(0);
+	return (command->value < 0) ? motionProgress <= command->value : motionProgress >= command->value;
+}
+
+// Wheel travel in mm left in the running command and the commands that blend with it
+static long motionRemaining(void) {
+	MotionCommand *command = motionAt(0);
+	int direction = (command->value < 0) ? -1 : 1;
+	long remaining = (command->value - motionProgress) * direction;
+	uint8_t i;
+	
+	for (i = 1; i < motionCount && motionBlends(motionAt(i - 1), motionAt(i)); i++) {
+		remaining += motionAt(i)->value * direction;
 	}
-	else if (rightBumper == 1 && leftBumper == 1) { //both bumpers are triggered
-		bumperFlag = 3;
+	if (command->type == MOTION_ROTATE) {
+		remaining = remaining * ARC_PER_1000_DEGREES / 1000; //degrees to wheel travel
 	}
+	return remaining;
 }
 
+// Fastest speed of the center of the robot for a command, mm/s
+static int motionMaxSpeed(const MotionCommand *command) {
+	if (command->type == MOTION_TRANSLATE && command->value < 0) {
+		return REVERSE_SPEED;
+	}
+	if (command->type == MOTION_ARC) { //keep the outer wheel under the limit
+		int radius = (command->radius < 0) ? -command->radius : command->radius;
+		return (long) MAX_SPEED * radius / (radius + HALF_WHEEL_BASE);
+	}
+	return MAX_SPEED;
+}
 
-/// Move the robot forward one distance increment
-/**
- * Sets the robot's wheels to move forward for a specified distance, updating sensors after each degree of wheel rotation
- * @param *sensor the struct holding the robot's sensor data
- * @param cm the distance to move
- */
-void moveForward(oi_t *sensor, int cm) {
-	oi_set_wheels(200, 200); //set wheels in motion
-	oi_update(sensor); //check sensors
-	bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
-	colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal); //ensure no tape is detected
-	checkSensors(sensor);
-	int totalDistance = 0;
+// Integer PID on the heading error of a translation, returns the wheel speed difference that corrects it
+static int headingTrim(void) {
+	int error = -motionHeading;
+	long trim;
 	
-	while(totalDistance <= cm*10 && //for given distance increment
-			cliffFlag == 0 && //while no cliffs detected
-			colorFlag == 0 && //while no white or black tape detected
-			bumperFlag == 0) {  //while no bumpers detected
-		oi_update(sensor);
-		bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
-		checkSensors(sensor);
-		colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal);
-		totalDistance += sensor->distance;
+	headingIntegral += error;
+	if (headingIntegral > HEADING_INTEGRAL_LIMIT) {
+		headingIntegral = HEADING_INTEGRAL_LIMIT;
 	}
+	if (headingIntegral < -HEADING_INTEGRAL_LIMIT) {
+		headingIntegral = -HEADING_INTEGRAL_LIMIT;
+	}
+	trim = ((long) headingKp * error + (long) headingKi * headingIntegral + (long) headingKd * (error - headingLastError)) / 16;
+	headingLastError = error;
 	
-	oi_set_wheels(0,0); //stop motion
-	checkSensors(sensor);
-	
-	if (colorFlag == 1) {
-		serial_putString("White tape detected.\n\r", 23);
+	if (trim > HEADING_TRIM_LIMIT) {
+		trim = HEADING_TRIM_LIMIT;
 	}
-	if (colorFlag == 2) {
-		serial_putString("Black tape detected!\n\r", 23);
+	if (trim < -HEADING_TRIM_LIMIT) {
+		trim = -HEADING_TRIM_LIMIT;
 	}
-	if (bumperFlag == 1) {
-		serial_putString("Left bumper triggered.\n\r", 25);
+	return trim;
+}
+
+// Limit a wheel speed to what the Create accepts
+static int wheelLimit(int speed) {
+	if (speed > MAX_SPEED) {
+		return MAX_SPEED;
 	}
-	if (bumperFlag == 2) {
-		serial_putString("Right bumper triggered.\n\r", 26);
+	if (speed < -MAX_SPEED) {
+		return -MAX_SPEED;
 	}
-	if (bumperFlag == 3) {
-		serial_putString("Both bumpers triggered.\n\r", 26);
+	return speed;
+}
+
+// Start a new straight line from the current heading, unless the robot is continuing one
+static void headingReset(const MotionCommand *next) {
+	if (next->type == MOTION_TRANSLATE && motionLastType == MOTION_TRANSLATE) {
+		return; //consecutive translations, even with stops between them, hold the same heading
 	}
-	if (cliffFlag == 1) {
-		serial_putString("Left cliff sensor triggered.\n\r", 31);
+	motionHeading = 0;
+	headingIntegral = 0;
+	headingLastError = 0;
+}
+
+// Command the wheels for the running command at the given speed
+static void motionDrive(const MotionCommand *command, int speed) {
+	if (command->value < 0) {
+		speed = -speed;
+	}
+	if (command->type == MOTION_TRANSLATE && headingHold) {
+		int trim = headingTrim(); //steer back to the heading the translation started on
+		oi_set_wheels(wheelLimit(speed + trim), wheelLimit(speed - trim));
+	}
+	else if (command->type == MOTION_ROTATE) {
+		oi_set_wheels(speed, -speed);
 	}
-	if (cliffFlag == 2) {
-		serial_putString("Front left cliff sensor triggered.\n\r", 37);
+	else if (command->type == MOTION_ARC && command->radius <= OI_DRIVE_MAX_RADIUS && command->radius >= -OI_DRIVE_MAX_RADIUS) {
+		oi_drive(speed, command->radius); //the Create splits the speed between the wheels
 	}
-	if (cliffFlag == 3) {
-		serial_putString("Front right cliff sensor triggered.\n\r", 38);
+	else if (command->type == MOTION_ARC) { //wider than the Create's drive command takes
+		oi_set_wheels((long) speed * (command->radius + HALF_WHEEL_BASE) / command->radius,
+				(long) speed * (command->radius - HALF_WHEEL_BASE) / command->radius);
 	}
-	if (cliffFlag == 4) {
-		serial_putString("Right cliff sensor triggered.\n\r", 32);
+	else {
+		oi_set_wheels(speed, speed);
 	}
 }
 
-/// Rotate the robot clockwise one degree increment
+/// Add a motion command to the queue
 /**
- * Sets the robot's wheels to rotate clockwise for a specified degree amount, updating sensors after each degree of wheel rotation
- * @param *sensor the struct holding the robot's sensor data
- * @param degrees the angle to rotate
+ * Queues a translation, rotation or arc behind the commands already waiting. Consecutive commands
+ * in the same direction run without slowing down in between.
+ * @param type MOTION_TRANSLATE, MOTION_ROTATE or MOTION_ARC
+ * @param value distance in mm (translate and arc) or angle in degrees, counterclockwise positive (rotate)
+ * @param radius arc radius in mm, positive turns left; ignored for translate and rotate
+ * @return 1 if the command was queued, 0 if the queue is full or the command is invalid
  */
-void rotateClockwise(oi_t *sensor, int degrees) {
-	int totalRotation = 0;
-	
-	oi_set_wheels(-200, 200); //begin rotation
-	oi_update(sensor); //check sensors
-	colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal); //check for colored tape
-	checkSensors(sensor);
-	bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
+char motionQueueCommand(uint8_t type, int value, int radius) {
+	MotionCommand *command;
 	
-	while (totalRotation >= degrees+rotationCalibration && //while still rotating
-			cliffFlag == 0 && //while no cliffs detected
-			colorFlag == 0 &&
-			bumperFlag == 0) { //while no colored tape detected
-		oi_update(sensor);
-		bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
-		colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal);
-		checkSensors(sensor);
-		totalRotation += sensor->angle;
+	if (motionCount == MOTION_QUEUE_SIZE || value == 0 || (type == MOTION_ARC && radius == 0)) {
+		return 0;
 	}
-	
-	oi_set_wheels(0,0); //stop rotation
-	checkSensors(sensor);
+	command = &motionQueue[(motionHead + motionCount) % MOTION_QUEUE_SIZE];
+	command->type = type;
+	command->value = value;
+	command->radius = (type == MOTION_ARC) ? radius : 0;
+	motionCount++;
+	return 1;
 }
 
-/// Rotate the robot clockwise one sixth of a degree increment
+/// Queue the motion that drives to a point
 /**
- * Sets the robot's wheels to rotate clockwise for a specified degree amount, updating sensors after each degree of wheel rotation
- * @param *sensor the struct holding the robot's sensor data
- * @param degrees the angle to rotate
+ * Reaches the point along one arc that starts on the current heading. Points more than 60 degrees off
+ * the heading are turned toward in place first, then driven to in a straight line.
+ * @param x distance ahead of the robot, mm
+ * @param y distance to the left of the robot, mm
+ * @return 1 if the motion was queued, 0 if the queue is too full
  */
-void rotateClockwiseFine(oi_t *sensor, int degrees) {
-	int totalRotation = 0;
+char motionGoTo(int x, int y) {
+	int16_t bearing = poseAtan2(y, x); //binary angle, 65536 is a full turn
+	unsigned long chordSquared = (long) x * x + (long) y * y;
+	unsigned int chord = poseSqrt(chordSquared);
+	unsigned int halfAngle = (bearing < 0) ? -bearing : bearing;
+	long radius;
+	long length;
 	
-	oi_set_wheels(-200, 200); //begin rotation
-	oi_update(sensor); //check sensors
-	colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal); //check for colored tape
-	checkSensors(sensor);
-	bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
-	
-	while (totalRotation >= (degrees+rotationCalibration)/6 && //while still rotating
-	cliffFlag == 0 && //while no cliffs detected
-	colorFlag == 0 &&
-	bumperFlag == 0) { //while no colored tape detected
-		oi_update(sensor);
-		bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
-		colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal);
-		checkSensors(sensor);
-		totalRotation += sensor->angle;
+	if (chord == 0) {
+		return 1;
 	}
-	
-	oi_set_wheels(0,0); //stop rotation
-	checkSensors(sensor);
+	if (halfAngle > GOTO_MAX_ARC_ANGLE) { //turn first, then drive straight
+		if (MOTION_QUEUE_SIZE - motionQueued() < 2) {
+			return 0;
+		}
+		motionQueueCommand(MOTION_ROTATE, ((long) bearing * 360) >> 16, 0);
+		return motionQueueCommand(MOTION_TRANSLATE, chord, 0);
+	}
+	if (y == 0) {
+		return motionQueueCommand(MOTION_TRANSLATE, chord, 0);
+	}
+	radius = (long) chordSquared / (2L * y); //circle through the point tangent to the heading, positive turns left
+	if (radius > 32767 || radius < -32767) { //as good as straight
+		return motionQueueCommand(MOTION_TRANSLATE, chord, 0);
+	}
+	length = ((radius < 0 ? -radius : radius) * halfAngle) / 5215; //radius * turn, the turn is twice the bearing
+	return motionQueueCommand(MOTION_ARC, length, radius);
+}
+
+/// Number of motion commands queued or running
+uint8_t motionQueued(void) {
+	return motionCount;
 }
 
-/// Rotate the robot counterclockwise one degree increment
+/// Run one period of the motion engine
 /**
- * Sets the robot's wheels to rotate counterclockwise for a specified degree amount, updating sensors after each degree of wheel rotation
+ * Halts at once if the frame parser tripped on a hazard, and otherwise returns immediately unless a control
+ * period is due. Then it reads the sensors, advances through the queue and updates the wheel speeds.
+ * Call it from the main loop as often as possible: the parser has already stopped the wheels on a hazard,
+ * dropping the queued commands is done here.
  * @param *sensor the struct holding the robot's sensor data
- * @param degrees the angle to rotate
  */
-void rotateCounterClockwise(oi_t *sensor, int degrees) {
-	int totalRotation = 0;
+void motionUpdate(oi_t *sensor) {
+	MotionCommand *command;
+	long remaining;
 	
-	oi_set_wheels(200, -200); //begin rotation
-	oi_update(sensor); //check sensors
-	colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal); //check for colored tape
-	checkSensors(sensor);
-	while (totalRotation <= (degrees-rotationCalibration) && //while still rotating
-			cliffFlag == 0 && //while no cliffs detected
-			colorFlag == 0 &&
-			bumperFlag == 0) { //while no colored tape detected
+	if (motionCount == 0) {
+		return;
+	}
+	if (motionActive && hazardTripped()) { //the frame parser stopped the wheels since the last call
+		motionHalt(sensor);
+		return;
+	}
+	if (!motionActive) { //start from rest
+		motionPackets(motionAt(0)); //only fetch what the command uses
+		oi_update(sensor); //start measuring from here
+		motionActive = 1;
+		motionProgress = 0;
+		motionSpeed = 0;
+		motionNextTick = clock_ms();
+		headingReset(motionAt(0));
+		hazardClear();
+	}
+	else {
+		if ((long) (clock_ms() - motionNextTick) < 0) { //next period not due yet
+			return;
+		}
 		oi_update(sensor);
-		bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
-		colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal);
-		checkSensors(sensor);
-		totalRotation += sensor->angle;
+		motionProgress += (motionAt(0)->type == MOTION_ROTATE) ? sensor->angle : sensor->distance;
+		motionHeading += sensor->angle;
 	}
 	
-	oi_set_wheels(0,0); //stop motion
-	checkSensors(sensor);
+	if (hazardTripped()) { //flagged while the sensors were being read
+		motionHalt(sensor);
+		return;
+	}
+	if (oi_is_stale(sensor, SENSOR_TIMEOUT_MS)) {
+		motionHalt(sensor);
+		return;
+	}
+	
+	while (motionCount > 0 && motionDone()) {
+		command = motionAt(0);
+		motionLastType = command->type;
+		motionHead = (motionHead + 1) % MOTION_QUEUE_SIZE;
+		motionCount--;
+		if (motionCount > 0 && motionBlends(command, motionAt(0))) {
+			motionProgress -= command->value; //carry the overshoot into the next command
+		}
+		else {
+			motionProgress = 0;
+			if (motionCount > 0) {
+				headingReset(motionAt(0));
+				motionPackets(motionAt(0));
+			}
+		}
+	}
+	if (motionCount == 0) {
+		oi_set_wheels(0,0);
+		motionActive = 0;
+		hazardArm(0);
+		motionPackets(NULL);
+		return;
+	}
+	
+	command = motionAt(0);
+	if (command->type == MOTION_TRANSLATE && command->value < 0) {
+		hazardArm(0); //backing up is how the robot gets away from a hazard
+	}
+	else {
+		hazardArm(HAZARD_ALL);
+	}
+	remaining = motionRemaining();
+	motionSpeed = profileSpeed(motionSpeed, remaining, motionMaxSpeed(command));
+	motionDrive(command, motionSpeed);
+	if (hazardTripped()) {
+		oi_set_wheels(0,0); //a hazard arrived while the speed was being sent; keep the stop last
+	}
+	
+	motionNextTick += controlPeriod;
+	if ((long) (clock_ms() - motionNextTick) > (long) controlPeriod) {
+		motionNextTick = clock_ms(); //fell behind, don't try to catch up
+	}
 }
 
-/// Rotate the robot counterclockwise one sixth of a degree increment
+/// Whether motion commands are still queued or running
+char motionBusy(void) {
+	return motionCount > 0;
+}
+
+/// Run the motion engine until the queue is empty
 /**
- * Sets the robot's wheels to rotate counterclockwise for a specified degree amount, updating sensors after each degree of wheel rotation
  * @param *sensor the struct holding the robot's sensor data
- * @param degrees the angle to rotate
  */
-void rotateCounterClockwiseFine(oi_t *sensor, int degrees) {
-	int totalRotation = 0;
-	
-	oi_set_wheels(200, -200); //begin rotation
-	oi_update(sensor); //check sensors
-	colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal); //check for colored tape
-	checkSensors(sensor);
-	while (totalRotation <= (degrees-rotationCalibration)/6 && //while still rotating
-	cliffFlag == 0 && //while no cliffs detected
-	colorFlag == 0 &&
-	bumperFlag == 0) { //while no colored tape detected
-		oi_update(sensor);
-		bumperCheck(sensor, sensor->bumper_left, sensor->bumper_right);
-		colorCheck(sensor->cliff_frontleft_signal, sensor->cliff_left_signal, sensor->cliff_right_signal, sensor->cliff_frontright_signal);
-		checkSensors(sensor);
-		totalRotation += sensor->angle;
+void motionWait(oi_t *sensor) {
+	while (motionBusy()) {
+		motionUpdate(sensor);
 	}
-	
-	oi_set_wheels(0,0); //stop motion
-	checkSensors(sensor);
 }
 
+/// Stop the robot and drop all queued motion commands
+void motionStop(void) {
+	oi_set_wheels(0,0);
+	motionActive = 0;
+	motionCount = 0;
+	hazardArm(0);
+	motionPackets(NULL);
+	hazardClear();
+}
+
+/// Turn heading hold for translations on or off
+/**
+ * With heading hold on, translations trim the wheel speeds to keep the heading they started with
+ * @param enabled 1 for on, 0 for off
+ */
+void setHeadingHold(char enabled) {
+	headingHold = enabled;
+}
+
+/// Whether heading hold is on
+char headingHoldEnabled(void) {
+	return headingHold;
+}
+
+/// Set the heading hold gains
+/**
+ * Gains are in 1/16 mm/s of wheel speed difference per degree of heading error
+ * @param kp proportional gain
+ * @param ki integral gain, per control period
+ * @param kd derivative gain, per control period
+ */
+void setHeadingGains(int kp, int ki, int kd) {
+	headingKp = kp;
+	headingKi = ki;
+	headingKd = kd;
+}
@@ -5,18 +5,37 @@
  *  Author: robideau
  */ 
 
-void moveForward(oi_t *sensor, int cm);
+#define MOTION_QUEUE_SIZE 8 //motion commands that can wait to run
 
-void moveBackward(oi_t *sensor, int cm);
+#define MOTION_TRANSLATE 0
+#define MOTION_ROTATE 1
+#define MOTION_ARC 2
 
-void rotateClockwise(oi_t *sensor, int degrees);
+/// A queued translation, rotation or arc
+typedef struct {
+	uint8_t type; //MOTION_TRANSLATE, MOTION_ROTATE or MOTION_ARC
+	int16_t value; //mm for translate and arc, degrees counterclockwise for rotate
+	int16_t radius; //arc radius in mm, positive turns left
+} MotionCommand;
 
-void rotateClockwiseFine(oi_t *sensor, int degrees);
+char motionQueueCommand(uint8_t type, int value, int radius);
 
-void rotateCounterClockwise(oi_t *sensor, int degrees);
+char motionGoTo(int x, int y);
 
-void rotateCounterClockwiseFine(oi_t *sensor, int degrees);
+uint8_t motionQueued(void);
 
-void checkSensors(oi_t *sensor_data);
+void motionUpdate(oi_t *sensor);
 
-void colorCheck(int frontLeft, int left, int right, int frontRight);
\ No newline at end of file
+char motionBusy(void);
+
+void motionWait(oi_t *sensor);
+
+void motionStop(void);
+
+void setControlRate(unsigned int hz);
+
+void setHeadingHold(char enabled);
+
+char headingHoldEnabled(void);
+
+void setHeadingGains(int kp, int ki, int kd);
\ No newline at end of file
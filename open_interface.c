@@ -1,6 +1,168 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "util.h"
+#include "serial.h"
 #include "open_interface.h"
+#include "pose.h"
+#include "hazard.h"
+
+// Link rates tried by oi_negotiate_baud(), fastest first. All are within 2.1% of the Create's rate at 16 MHz.
+typedef struct {
+	uint8_t code;         // OI baud code
+	uint8_t ubrr;         // UBRR = (FOSC/16/BAUD-1), or (FOSC/8/BAUD-1) with double speed
+	uint8_t double_speed; // 1 to set U2X
+	unsigned long baud;
+} oi_baud_t;
+
+static const oi_baud_t oi_baud_rates[] = {
+	{11, 16, 1, 115200},
+	{10, 16, 0, 57600},
+	{9,  25, 0, 38400},
+	{8,  33, 0, 28800},
+};
+#define OI_BAUD_RATES (sizeof(oi_baud_rates) / sizeof(oi_baud_rates[0]))
+
+// Average small-query round trip at the negotiated rate, in microseconds
+static unsigned long oi_latency_us = 0;
+
+// Round trips used to verify and measure a link rate
+#define OI_BAUD_LATENCY_TRIPS 10
+#define OI_BAUD_THROUGHPUT_TRIPS 8
+// Time to wait for a reply byte before a link rate is considered broken
+#define OI_RX_TIMEOUT_MS 50
+
+// Default packet set: bumpers, cliff flags, distance, angle and cliff signals.
+// 28 payload bytes per stream frame, which fits in the 15 ms stream period at 28800 baud.
+static const uint8_t oi_default_packets[] = {7, 9, 10, 11, 12, 19, 20, 28, 29, 30, 31};
+
+// The Create sends a stream frame every 15 ms; a frame that takes longer on the wire backs the stream up
+#define OI_STREAM_PERIOD_MS 15
+// Largest stream payload that fits in a stream period at the link rate in use, set by oi_use_baud(...)
+static uint8_t oi_stream_budget = OI_STREAM_MAX_PAYLOAD; // USART1 starts at 57600, where the parser's limit is lower
+
+// Packets fetched by oi_update(...), registered with oi_set_packets(...)
+static const uint8_t *oi_packet_list = oi_default_packets;
+static uint8_t oi_packet_count = sizeof(oi_default_packets);
+
+// Stream frame parser states
+#define OI_STREAM_WAIT_HEADER 0
+#define OI_STREAM_WAIT_LENGTH 1
+#define OI_STREAM_PAYLOAD     2
+#define OI_STREAM_CHECKSUM    3
+
+static volatile uint8_t oi_streaming = 0;
+static volatile uint16_t oi_stream_error_count = 0;
+static uint8_t oi_stream_state = OI_STREAM_WAIT_HEADER;
+static uint8_t oi_stream_length;
+static uint8_t oi_stream_index;
+static uint8_t oi_stream_sum;
+static uint8_t oi_stream_payload[OI_STREAM_MAX_PAYLOAD];
+
+// Double-buffered stream frames. The receive interrupt decodes into the back buffer and then publishes it;
+// readers copy the published buffer and retry if the sequence number moved while they were copying.
+static oi_t oi_frames[2];
+static volatile uint8_t oi_frame_published = 0; // index of the buffer readers may copy
+static volatile uint8_t oi_frame_sequence = 0;  // incremented each time a frame is published
+
+// Keeps the compiler from moving oi_frames accesses across the reads and writes of the sequence number;
+// oi_frames is not volatile so the frame copies stay plain memcpy-style loops
+#define OI_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// Sensor packet descriptor types: width and signedness of the data, or a single bit of a flags byte
+#define OI_U8   0
+#define OI_S8   1
+#define OI_U16  2
+#define OI_S16  3
+#define OI_BIT  4 // one bit of a 1-byte packet, stored as 0 or 1
+#define OI_SKIP 5 // 1-byte packet with no destination
+
+// Describes where one sensor packet (or one bit of it) is stored in oi_t
+typedef struct {
+	uint8_t id;     // packet id, 7-42
+	uint8_t type;   // OI_U8, OI_S8, OI_U16, OI_S16, OI_BIT or OI_SKIP
+	uint8_t bit;    // bit number for OI_BIT
+	uint8_t offset; // offsetof(oi_t, field)
+} oi_packet_t;
+
+#define OI_FIELD(id, type, field)    {id, type, 0, offsetof(oi_t, field)}
+#define OI_FLAG(id, bit, field)      {id, OI_BIT, bit, offsetof(oi_t, field)}
+
+// Every sensor packet in id order. Packets with several flags have one entry per flag.
+// Because the table is in id order it is also the wire layout of group 6, and an id's first entry
+// is never before index id - 7.
+static const oi_packet_t oi_packets[] PROGMEM = {
+	OI_FLAG(7, 0, bumper_right),
+	OI_FLAG(7, 1, bumper_left),
+	OI_FLAG(7, 2, wheeldrop_right),
+	OI_FLAG(7, 3, wheeldrop_left),
+	OI_FLAG(7, 4, wheeldrop_caster),
+	OI_FIELD(8, OI_U8, wall),
+	OI_FIELD(9, OI_U8, cliff_left),
+	OI_FIELD(10, OI_U8, cliff_frontleft),
+	OI_FIELD(11, OI_U8, cliff_frontright),
+	OI_FIELD(12, OI_U8, cliff_right),
+	OI_FIELD(13, OI_U8, virtual_wall),
+	OI_FLAG(14, 0, overcurrent_ld1),
+	OI_FLAG(14, 1, overcurrent_ld0),
+	OI_FLAG(14, 2, overcurrent_ld2),
+	OI_FLAG(14, 3, overcurrent_driveright),
+	OI_FLAG(14, 4, overcurrent_driveleft),
+	{15, OI_SKIP, 0, 0}, // unused
+	{16, OI_SKIP, 0, 0}, // unused
+	OI_FIELD(17, OI_U8, infrared_byte),
+	OI_FLAG(18, 0, button_play),
+	OI_FLAG(18, 2, button_advance),
+	OI_FIELD(19, OI_S16, distance),
+	OI_FIELD(20, OI_S16, angle),
+	OI_FIELD(21, OI_U8, charging_state),
+	OI_FIELD(22, OI_U16, voltage),
+	OI_FIELD(23, OI_S16, current),
+	OI_FIELD(24, OI_S8, temperature),
+	OI_FIELD(25, OI_U16, charge),
+	OI_FIELD(26, OI_U16, capacity),
+	OI_FIELD(27, OI_U16, wall_signal),
+	OI_FIELD(28, OI_U16, cliff_left_signal),
+	OI_FIELD(29, OI_U16, cliff_frontleft_signal),
+	OI_FIELD(30, OI_U16, cliff_frontright_signal),
+	OI_FIELD(31, OI_U16, cliff_right_signal),
+	OI_FLAG(32, 0, cargo_bay_io0),
+	OI_FLAG(32, 1, cargo_bay_io1),
+	OI_FLAG(32, 2, cargo_bay_io2),
+	OI_FLAG(32, 3, cargo_bay_io3),
+	OI_FLAG(32, 4, cargo_bay_baud),
+	OI_FIELD(33, OI_U16, cargo_bay_voltage),
+	OI_FLAG(34, 0, internal_charger_on),
+	OI_FLAG(34, 1, home_base_charger_on),
+	OI_FIELD(35, OI_U8, oi_mode),
+	OI_FIELD(36, OI_U8, song_number),
+	OI_FIELD(37, OI_U8, song_playing),
+	OI_FIELD(38, OI_U8, number_packets),
+	OI_FIELD(39, OI_S16, requested_velocity),
+	OI_FIELD(40, OI_S16, requested_radius),
+	OI_FIELD(41, OI_S16, requested_right_velocity),
+	OI_FIELD(42, OI_S16, requested_left_velocity),
+};
+#define OI_PACKET_ENTRIES (sizeof(oi_packets) / sizeof(oi_packets[0]))
+
+// Size of packet group 6 (packets 7-42) in bytes
+#define OI_GROUP6_LENGTH 52
+
+static uint8_t oi_packet_width(uint8_t id);
+static void oi_packet_list_tx(uint8_t opcode);
+static void oi_decode_packet(oi_t *self, uint8_t id, const uint8_t *data);
+static uint8_t oi_decode_packets(oi_t *self, const uint8_t *data, uint8_t length);
+static void oi_decode_group6(oi_t *self, const uint8_t *data);
+static void oi_count_frame(oi_t *self);
+
+// Transmit queue, drained by the USART1 data register empty interrupt
+static volatile uint8_t oi_tx_buffer[OI_TX_BUFFER_SIZE];
+static volatile uint8_t oi_tx_head = 0; // next free slot, written by oi_command_tx(...)
+static volatile uint8_t oi_tx_tail = 0; // next byte to send, written by the interrupt
+static volatile uint8_t oi_tx_high_water_mark = 0;
 
 /// Allocate memory for a the sensor data
 oi_t* oi_alloc() {
@@ -15,19 +177,18 @@ void oi_free(oi_t *self) {
 /// Initialize the Create
 void oi_init(oi_t *self) {
 	// Setup USART1 to communicate to the iRobot Create using serial (baud = 57600)
+	UBRR1H = 0;
 	UBRR1L = 16; // UBRR = (FOSC/16/BAUD-1);
+	UCSR1A &= ~(1 << U2X);
 	UCSR1B = (1 << RXEN) | (1 << TXEN);
 	UCSR1C = (3 << UCSZ10);
+	sei(); // commands are sent by the data register empty interrupt
 
 	// Starts the SCI. Must be sent first
 	oi_byte_tx(OI_OPCODE_START);
-	oi_byte_tx(OI_OPCODE_BAUD);
-
-	oi_byte_tx(8); // baud code for 28800
-	wait_ms(100);
 	
-	// Set the baud rate on the Cerebot II to match the Create's baud
-	UBRR1L = 33; // UBRR = (FOSC/16/BAUD-1);
+	// Move both ends to the fastest rate that passes a sensor round trip
+	oi_negotiate_baud();
 
 	// Use Full mode, unrestricted control
 	oi_byte_tx(OI_OPCODE_FULL);
@@ -35,6 +196,168 @@ void oi_init(oi_t *self) {
 	
 	oi_update(self);
 	oi_update(self); // call twice to clear distance/angle
+	
+	oi_stream_start(self);
+}
+
+
+
+// Sets USART1 to a link rate without telling the Create
+static void oi_use_baud(const oi_baud_t *rate) {
+	// 10 bits per byte on the wire; the header, length and checksum bytes go around the payload
+	unsigned long frame = rate->baud * OI_STREAM_PERIOD_MS / 10000;
+	
+	oi_stream_budget = MIN(frame - 3, OI_STREAM_MAX_PAYLOAD);
+	UBRR1H = 0;
+	UBRR1L = rate->ubrr;
+	if (rate->double_speed) {
+		UCSR1A |= (1 << U2X);
+	}
+	else {
+		UCSR1A &= ~(1 << U2X);
+	}
+}
+
+
+
+/// Switches the Create and USART1 to a new link rate
+/**
+* The baud command is sent at USART1's current rate, which must be the one the Create is listening at.
+* @rate the entry of oi_baud_rates to switch to
+*/
+static void oi_set_baud(const oi_baud_t *rate) {
+	uint8_t command[2] = {OI_OPCODE_BAUD, rate->code};
+	oi_command_tx(command, sizeof(command));
+	oi_tx_flush(); // the baud command must be on the wire before the rate changes
+	wait_ms(100);  // the Create needs 100 ms before it accepts commands at the new rate
+	
+	// Set the baud rate on the Cerebot II to match the Create's baud
+	oi_use_baud(rate);
+}
+
+
+
+// Receive a byte from the Create, giving up after a timeout. Returns -1 on timeout or a framing error.
+static int oi_byte_rx_timeout(unsigned int ms) {
+	unsigned long start = clock_ms();
+	
+	while (!(UCSR1A & (1 << RXC))) {
+		if (clock_ms() - start > ms) {
+			return -1;
+		}
+	}
+	if (UCSR1A & ((1 << FE) | (1 << DOR))) {
+		(void) OI_UDR1_READ();
+		return -1;
+	}
+	return OI_UDR1_READ();
+}
+
+
+
+// Queries group 6 (or only packet 35 when quick is set) and checks the reply.
+// Returns 1 if every byte arrived in time and the OI mode byte is passive, safe or full.
+static uint8_t oi_verify_link(uint8_t quick) {
+	uint8_t command[2] = {OI_OPCODE_SENSORS, quick ? 35 : OI_SENSOR_PACKET_GROUP6};
+	uint8_t length = quick ? 1 : 52;
+	uint8_t mode_offset = quick ? 0 : 40; // packet 35 follows 40 bytes of packets 7-34 in group 6
+	int value = 0;
+	uint8_t i;
+	
+	while (UCSR1A & (1 << RXC)) // clear the receive buffer
+		(void) OI_UDR1_READ();
+	
+	oi_command_tx(command, sizeof(command));
+	for (i = 0; i < length; i++) {
+		int received = oi_byte_rx_timeout(OI_RX_TIMEOUT_MS);
+		if (received < 0) {
+			return 0;
+		}
+		if (i == mode_offset) {
+			value = received;
+		}
+	}
+	return value >= 1 && value <= 3;
+}
+
+
+
+// Brings both ends back to the last verified rate after a rate failed verification.
+// If the Create is not answering at the verified rate it did switch, so it is told to go back at the failed rate.
+static void oi_recover_baud(const oi_baud_t *verified, const oi_baud_t *failed) {
+	oi_use_baud(verified);
+	if (verified == failed || oi_verify_link(1)) {
+		return; // the Create never switched
+	}
+	oi_use_baud(failed);
+	oi_set_baud(verified);
+}
+
+
+
+/// Negotiates the fastest reliable link rate with the Create
+/**
+* Tries each rate from fastest to slowest, switching the Create with the baud opcode and verifying
+* with sensor round trips. Every baud command is sent at the last rate both ends agreed on, starting
+* from the Create's power-on 57600, so a rate the Create never switched to doesn't strand the next one.
+* The first rate that passes is kept; 28800 is used, and checked again, if none pass.
+* The rate, measured throughput and round-trip latency are reported on the serial console.
+* Requires clock_init(), USART1 at 57600 and passive mode, before the sensor stream is started.
+* @return the baud rate in use
+*/
+unsigned long oi_negotiate_baud(void) {
+	const oi_baud_t *verified = &oi_baud_rates[1]; // 57600, the rate the Create starts at
+	char report[80];
+	uint8_t r;
+	uint8_t i;
+	
+	for (r = 0; r < OI_BAUD_RATES; r++) {
+		const oi_baud_t *rate = &oi_baud_rates[r];
+		if (rate != verified) {
+			oi_set_baud(rate);
+		}
+		
+		// small queries: verify and measure the round-trip latency
+		uint8_t ok = 1;
+		unsigned long start = clock_us();
+		for (i = 0; i < OI_BAUD_LATENCY_TRIPS && ok; i++) {
+			ok = oi_verify_link(1);
+		}
+		unsigned long latency_us = (clock_us() - start) / OI_BAUD_LATENCY_TRIPS;
+		
+		// full group 6 reads: verify and measure throughput
+		start = clock_ms();
+		for (i = 0; i < OI_BAUD_THROUGHPUT_TRIPS && ok; i++) {
+			ok = oi_verify_link(0);
+		}
+		unsigned long elapsed = clock_ms() - start;
+		
+		if (ok) {
+			unsigned long bytes_per_sec = elapsed ? (52UL * OI_BAUD_THROUGHPUT_TRIPS * 1000) / elapsed : 0;
+			sprintf(report, "OI link: %lu baud, %lu bytes/s, %lu us round trip\n\r", rate->baud, bytes_per_sec, latency_us);
+			serial_putString(report, strlen(report));
+			oi_latency_us = latency_us;
+			return rate->baud;
+		}
+		sprintf(report, "OI link: %lu baud failed\n\r", rate->baud);
+		serial_putString(report, strlen(report));
+		oi_recover_baud(verified, rate);
+	}
+	
+	// nothing verified, fall back to the slowest rate from wherever the Create is now
+	const oi_baud_t *slowest = &oi_baud_rates[OI_BAUD_RATES - 1];
+	oi_latency_us = 0;
+	oi_set_baud(slowest);
+	sprintf(report, "OI link: fell back to %lu baud, %s\n\r", slowest->baud, oi_verify_link(1) ? "verified" : "not answering");
+	serial_putString(report, strlen(report));
+	return slowest->baud;
+}
+
+
+
+/// Average sensor round trip measured at the rate oi_negotiate_baud() kept, in microseconds; 0 if it fell back
+unsigned long oi_link_latency(void) {
+	return oi_latency_us;
 }
 
 
@@ -43,47 +366,378 @@ void oi_init(oi_t *self) {
 void oi_update(oi_t *self) {
 	int i;
 
+	if (oi_streaming) {
+		// Take the latest streamed frame; distance and angle become the motion since this struct's last update
+		int32_t distance_total = self->distance_total;
+		int32_t angle_total = self->angle_total;
+		oi_snapshot(self);
+		self->distance = self->distance_total - distance_total;
+		self->angle = self->angle_total - angle_total;
+		return;
+	}
+
 	// Clear the receive buffer
 	while (UCSR1A & (1 << RXC)) 
-		i = UDR1;
+		i = OI_UDR1_READ();
+
+	if (oi_packet_count > 0) {
+		// Query only the registered packets; the reply is their data bytes in list order
+		uint8_t data[2];
+		oi_packet_list_tx(OI_OPCODE_QUERY_LIST);
+		for (i = 0; i < oi_packet_count; i++) {
+			uint8_t width = oi_packet_width(oi_packet_list[i]);
+			data[0] = oi_byte_rx();
+			if (width == 2) {
+				data[1] = oi_byte_rx();
+			}
+			oi_decode_packet(self, oi_packet_list[i], data);
+		}
+		oi_count_frame(self);
+		wait_ms(35); // reduces USART errors that occur when continuously transmitting/receiving
+		return;
+	}
 
-	// Query a list of sensor values
-	oi_byte_tx(OI_OPCODE_SENSORS);
-	// Send the sensor packet ID
-	oi_byte_tx(OI_SENSOR_PACKET_GROUP6); 
+	// Query a list of sensor values and send the sensor packet ID
+	uint8_t command[2] = {OI_OPCODE_SENSORS, OI_SENSOR_PACKET_GROUP6};
+	oi_command_tx(command, sizeof(command));
 
 	// Read all the sensor data
-	char *sensor = (char *) self;
-	for (i = 0; i < 52; i++) {
+	uint8_t sensor[OI_GROUP6_LENGTH];
+	for (i = 0; i < OI_GROUP6_LENGTH; i++) {
 		// read each sensor byte
-		*(sensor++) = oi_byte_rx();
-	}
-	
-	sensor = (char *) self;
-	
-	// Fix byte ordering for multi-byte members of the struct
-	self->distance                 = (sensor[12] << 8) + sensor[13];
-	self->angle                    = (sensor[14] << 8) + sensor[15];
-	self->voltage                  = (sensor[17] << 8) + sensor[18];
-	self->current                  = (sensor[19] << 8) + sensor[20];
-	self->charge                   = (sensor[22] << 8) + sensor[23];
-	self->capacity                 = (sensor[24] << 8) + sensor[25];
-	self->wall_signal              = (sensor[26] << 8) + sensor[27];
-	self->cliff_left_signal        = (sensor[28] << 8) + sensor[29];
-	self->cliff_frontleft_signal   = (sensor[30] << 8) + sensor[31]; 
-	self->cliff_frontright_signal  = (sensor[32] << 8) + sensor[33];
-	self->cliff_right_signal       = (sensor[34] << 8) + sensor[35];
-	self->cargo_bay_voltage        = (sensor[41] << 8) + sensor[42];
-	self->requested_velocity       = (sensor[48] << 8) + sensor[42];
-	self->requested_radius         = (sensor[50] << 8) + sensor[51];
-	self->requested_right_velocity = (sensor[52] << 8) + sensor[53];
-	self->requested_left_velocity  = (sensor[54] << 8) + sensor[55];
+		sensor[i] = oi_byte_rx();
+	}
+	oi_decode_group6(self, sensor);
+	oi_count_frame(self);
 	
 	wait_ms(35); // reduces USART errors that occur when continuously transmitting/receiving
 }
 
 
 
+/// Registers the sensor packets fetched by oi_update
+/**
+* Callers declare only the packets they use so each update moves fewer bytes over the link.
+* Polled updates send the list with a query list command; a running stream is restarted with the new list.
+* A list is rejected, and the registered one kept, if it holds an id that is not a single packet or if its
+* stream frame would take longer than the 15 ms stream period at the rate oi_negotiate_baud() kept - about
+* 40 payload bytes at 28800 baud, and never more than the frame parser's OI_STREAM_MAX_PAYLOAD.
+* @packets      list of single packet ids (7-42), which must stay valid until the next call; NULL restores the default set
+* @count        number of ids in the list; 0 with a NULL list reads the full group 6 instead (polled updates only)
+* @return the number of ids registered, 0 if the list was rejected
+*/
+uint8_t oi_set_packets(const uint8_t *packets, uint8_t count) {
+	uint8_t payload = 0;
+	uint8_t i;
+	
+	if (packets == NULL || (count == 0 && oi_streaming)) {
+		packets = oi_default_packets;
+		count = (count || oi_streaming) ? sizeof(oi_default_packets) : 0;
+	}
+	if (count > OI_MAX_PACKET_LIST) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		uint8_t width = oi_packet_width(packets[i]);
+		if (width == 0 || payload + 1 + width > oi_stream_budget) {
+			return 0; // a stream of this list would fall further behind every frame
+		}
+		payload += 1 + width;
+	}
+	if (packets == oi_packet_list && count == oi_packet_count) {
+		return count; // already registered, nothing to send
+	}
+	oi_packet_list = packets;
+	oi_packet_count = count;
+	
+	if (oi_streaming) {
+		oi_packet_list_tx(OI_OPCODE_STREAM); // replaces the list of the running stream
+	}
+	return count;
+}
+
+
+
+/// Starts the Create's sensor stream
+/**
+* Requests the registered sensor packets every 15 ms and enables the USART1 receive interrupt,
+* which parses each frame into the snapshot returned by oi_update(...).
+* @self sensor data used to seed the fields that are not part of the stream
+*/
+void oi_stream_start(oi_t *self) {
+	uint8_t sreg = SREG;
+	
+	cli();
+	oi_frames[0] = *self;
+	oi_frames[0].distance = 0;
+	oi_frames[0].angle = 0;
+	oi_frames[1] = oi_frames[0];
+	oi_frame_sequence++;
+	oi_stream_state = OI_STREAM_WAIT_HEADER;
+	SREG = sreg;
+	
+	if (oi_packet_count == 0) {
+		oi_packet_list = oi_default_packets; // the whole of group 6 does not fit in a 15 ms frame
+		oi_packet_count = sizeof(oi_default_packets);
+	}
+	oi_packet_list_tx(OI_OPCODE_STREAM);
+	
+	oi_streaming = 1;
+	UCSR1B |= (1 << RXCIE); // parse incoming frames in the background
+	sei();
+}
+
+
+
+// Sends the registered packet list with a stream or query list opcode
+static void oi_packet_list_tx(uint8_t opcode) {
+	uint8_t i;
+	uint8_t command[2 + OI_MAX_PACKET_LIST];
+	
+	command[0] = opcode;
+	command[1] = oi_packet_count;
+	for (i = 0; i < oi_packet_count; i++) {
+		command[2 + i] = oi_packet_list[i];
+	}
+	oi_command_tx(command, 2 + oi_packet_count);
+}
+
+
+
+/// Pauses the Create's sensor stream
+void oi_stream_stop(void) {
+	uint8_t command[2] = {OI_OPCODE_DO_STREAM, 0}; // 0 = pause
+	oi_command_tx(command, sizeof(command));
+	
+	UCSR1B &= ~(1 << RXCIE);
+	oi_streaming = 0;
+	wait_ms(20); // let a frame already on the wire finish; oi_update(...) clears the receive buffer
+}
+
+
+
+/// Parses one byte of a sensor stream frame
+/**
+* Frames are [19][n-bytes][packet id][data]...[checksum], where all bytes of the frame sum to 0.
+* A valid frame is decoded into the stream snapshot; bad frames are counted and dropped.
+* @value the byte received from the Create
+* @return 1 if the byte completed a valid frame, 0 otherwise
+*/
+uint8_t oi_stream_parse(uint8_t value) {
+	switch (oi_stream_state) {
+	case OI_STREAM_WAIT_HEADER:
+		if (value == OI_STREAM_HEADER) {
+			oi_stream_sum = value;
+			oi_stream_state = OI_STREAM_WAIT_LENGTH;
+		}
+		break;
+	case OI_STREAM_WAIT_LENGTH:
+		if (value == 0 || value > OI_STREAM_MAX_PAYLOAD) { // not a frame we asked for; resynchronize
+			oi_stream_error_count++;
+			oi_stream_state = OI_STREAM_WAIT_HEADER;
+			break;
+		}
+		oi_stream_length = value;
+		oi_stream_index = 0;
+		oi_stream_sum += value;
+		oi_stream_state = OI_STREAM_PAYLOAD;
+		break;
+	case OI_STREAM_PAYLOAD:
+		oi_stream_payload[oi_stream_index++] = value;
+		oi_stream_sum += value;
+		if (oi_stream_index == oi_stream_length) {
+			oi_stream_state = OI_STREAM_CHECKSUM;
+		}
+		break;
+	case OI_STREAM_CHECKSUM:
+		oi_stream_state = OI_STREAM_WAIT_HEADER;
+		if ((uint8_t) (oi_stream_sum + value) != 0) {
+			oi_stream_error_count++;
+			break;
+		}
+		// build the next frame in the back buffer, starting from the published one for packets not in this frame
+		uint8_t back = oi_frame_published ^ 1;
+		oi_frames[back] = oi_frames[oi_frame_published];
+		oi_frames[back].distance = 0; // relative to the previous frame, 0 unless this frame carries it
+		oi_frames[back].angle = 0;
+		if (!oi_decode_packets(&oi_frames[back], oi_stream_payload, oi_stream_length)) {
+			oi_stream_error_count++;
+			return 0;
+		}
+		oi_count_frame(&oi_frames[back]);
+		OI_BARRIER(); // the whole frame is written before readers can see it
+		oi_frame_published = back;
+		oi_frame_sequence++;
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/// Copies the latest published sensor frame
+/**
+* Never disables interrupts: the copy is retried if a new frame was published while it was being made.
+* Between calls to this function the stream keeps adding to distance_total and angle_total, while
+* distance and angle hold only the motion reported in the copied frame.
+* @dest the struct to copy the frame into
+*/
+void oi_snapshot(oi_t *dest) {
+	uint8_t sequence;
+	
+	do {
+		sequence = oi_frame_sequence;
+		OI_BARRIER();
+		*dest = oi_frames[oi_frame_published];
+		OI_BARRIER(); // the copy is finished before the sequence number is checked again
+	} while (sequence != oi_frame_sequence);
+}
+
+
+
+/// Checks whether sensor data is too old to act on
+/**
+* @self  sensor data from oi_update(...) or oi_snapshot(...)
+* @max_age_ms the oldest acceptable frame, in milliseconds
+* @return 1 if the frame was received more than max_age_ms ago, 0 otherwise
+*/
+uint8_t oi_is_stale(const oi_t *self, unsigned long max_age_ms) {
+	return clock_ms() - self->timestamp > max_age_ms;
+}
+
+
+
+// Stamps a newly decoded frame and adds its motion to the running odometry totals
+static void oi_count_frame(oi_t *self) {
+	self->frame_number++;
+	self->timestamp = clock_ms();
+	self->distance_total += self->distance;
+	self->angle_total += self->angle; //both totals are up to date before anything looks at the frame
+	poseUpdate(self->distance, self->angle); //odometry sees every frame
+	hazardUpdate(self); //flag a hazard within one frame
+}
+
+
+
+/// Number of stream frames dropped because of a bad length, checksum or unknown packet
+uint16_t oi_stream_errors(void) {
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t errors = oi_stream_error_count;
+	SREG = sreg;
+	return errors;
+}
+
+
+
+// Receive interrupt for USART1; only enabled while the sensor stream is running
+ISR (USART1_RX_vect) {
+	uint8_t status = UCSR1A;
+	uint8_t value = OI_UDR1_READ();
+	
+	if (status & ((1 << FE) | (1 << DOR))) { // framing error or overrun, current frame is lost
+		oi_stream_error_count++;
+		oi_stream_state = OI_STREAM_WAIT_HEADER;
+		return;
+	}
+	oi_stream_parse(value);
+}
+
+
+
+// Index of the first descriptor for a packet id, or OI_PACKET_ENTRIES if the id is not a single packet
+static uint8_t oi_packet_entry(uint8_t id) {
+	uint8_t i;
+	
+	if (id < 7 || id > 42) {
+		return OI_PACKET_ENTRIES;
+	}
+	for (i = id - 7; pgm_read_byte(&oi_packets[i].id) != id; i++); // at most a few flag entries to skip
+	return i;
+}
+
+
+
+// Size in bytes of the data for a single sensor packet id, or 0 if the id is not a single packet
+static uint8_t oi_packet_width(uint8_t id) {
+	uint8_t i = oi_packet_entry(id);
+	
+	if (i == OI_PACKET_ENTRIES) {
+		return 0;
+	}
+	return (pgm_read_byte(&oi_packets[i].type) >= OI_U16 && pgm_read_byte(&oi_packets[i].type) <= OI_S16) ? 2 : 1;
+}
+
+
+
+// Stores one descriptor's share of a packet's data bytes into the sensor struct
+static void oi_decode_entry(oi_t *self, uint8_t i, const uint8_t *data) {
+	uint8_t *field = (uint8_t *) self + pgm_read_byte(&oi_packets[i].offset);
+	
+	switch (pgm_read_byte(&oi_packets[i].type)) {
+	case OI_U8:
+	case OI_S8:
+		*field = data[0];
+		break;
+	case OI_U16:
+	case OI_S16:
+		*(uint16_t *) field = (data[0] << 8) | data[1]; // packets are big endian
+		break;
+	case OI_BIT:
+		*field = (data[0] >> pgm_read_byte(&oi_packets[i].bit)) & 0x01;
+		break;
+	}
+}
+
+
+
+// Decodes a sequence of [packet id][data] pairs into the sensor struct.
+// Returns 0 if an unknown packet id or a truncated packet is found.
+static uint8_t oi_decode_packets(oi_t *self, const uint8_t *data, uint8_t length) {
+	uint8_t i = 0;
+	
+	while (i < length) {
+		uint8_t id = data[i++];
+		uint8_t width = oi_packet_width(id);
+		if (width == 0 || i + width > length) {
+			return 0;
+		}
+		oi_decode_packet(self, id, &data[i]);
+		i += width;
+	}
+	return 1;
+}
+
+
+
+// Decodes the data bytes of a single sensor packet into the sensor struct
+static void oi_decode_packet(oi_t *self, uint8_t id, const uint8_t *data) {
+	uint8_t i;
+	
+	for (i = oi_packet_entry(id); i < OI_PACKET_ENTRIES && pgm_read_byte(&oi_packets[i].id) == id; i++) {
+		oi_decode_entry(self, i, data);
+	}
+}
+
+
+
+// Decodes a group 6 reply (packets 7-42 back to back) in a single pass over the descriptor table
+static void oi_decode_group6(oi_t *self, const uint8_t *data) {
+	uint8_t i;
+	uint8_t id = 7;
+	
+	for (i = 0; i < OI_PACKET_ENTRIES; i++) {
+		uint8_t entry_id = pgm_read_byte(&oi_packets[i].id);
+		if (entry_id != id) { // moved on to the next packet
+			data += oi_packet_width(id);
+			id = entry_id;
+		}
+		oi_decode_entry(self, i, data);
+	}
+}
+
+
+
 /// Sets the LEDs on the iRobot.
 /**
 * Set the state of the three LEDs on the iRobot (Power, Play, Advance).
@@ -93,48 +747,70 @@ void oi_update(oi_t *self) {
 * @power_intensity uint8_t the intensity of the power LED; 0 = off, 255 = full intensity
 */
 void oi_set_leds(uint8_t play_led, uint8_t advance_led, uint8_t power_color, uint8_t power_intensity) {
+	uint8_t command[4];
+	
 	// LED Opcode
-	oi_byte_tx(OI_OPCODE_LEDS);
+	command[0] = OI_OPCODE_LEDS;
 
 	// Set the Play and Advance LEDs
-	oi_byte_tx(advance_led << 3 && play_led << 2);
+	command[1] = (advance_led << 3) | (play_led << 1);
 
 	// Set the power led color
-	oi_byte_tx(power_color);
+	command[2] = power_color;
 
 	// Set the power led intensity
-	oi_byte_tx(power_intensity);
+	command[3] = power_intensity;
+	
+	oi_command_tx(command, sizeof(command));
+}
+
+
+
+/// Drive along a circle of the given radius; velocity is in mm / sec, radius in mm
+void oi_drive(int16_t velocity, int16_t radius) {
+	uint8_t command[5];
+	command[0] = OI_OPCODE_DRIVE;
+	command[1] = velocity>>8;
+	command[2] = velocity & 0xff;
+	command[3] = radius>>8;
+	command[4] = radius & 0xff;
+	oi_command_tx(command, sizeof(command));
 }
 
 
 
 /// Drive wheels directly; speeds are in mm / sec
 void oi_set_wheels(int16_t right_wheel, int16_t left_wheel) {
-	oi_byte_tx(OI_OPCODE_DRIVE_WHEELS);
-	oi_byte_tx(right_wheel>>8);
-	oi_byte_tx(right_wheel & 0xff);
-	oi_byte_tx(left_wheel>>8);
-	oi_byte_tx(left_wheel& 0xff);
+	uint8_t command[5];
+	command[0] = OI_OPCODE_DRIVE_WHEELS;
+	command[1] = right_wheel>>8;
+	command[2] = right_wheel & 0xff;
+	command[3] = left_wheel>>8;
+	command[4] = left_wheel& 0xff;
+	oi_command_tx(command, sizeof(command));
 }
 
 
 /// Loads a song onto the iRobot Create
 void oi_load_song(int song_index, int num_notes, unsigned char *notes, unsigned char *duration) {
 	int i;
-	oi_byte_tx(OI_OPCODE_SONG);
-	oi_byte_tx(song_index);
-	oi_byte_tx(num_notes);
+	uint8_t command[3 + 2*16];
+	num_notes = MIN(num_notes, 16); // the Create holds at most 16 notes per song
+	command[0] = OI_OPCODE_SONG;
+	command[1] = song_index;
+	command[2] = num_notes;
 	for (i=0;i<num_notes;i++) {
-		oi_byte_tx(notes[i]);
-		oi_byte_tx(duration[i]);
+		command[3 + 2*i] = notes[i];
+		command[4 + 2*i] = duration[i];
 	}
+	oi_command_tx(command, 3 + 2*num_notes);
 }
 
 
 /// Plays a given song; use oi_load_song(...) first
 void oi_play_song(int index){
-	oi_byte_tx(OI_OPCODE_PLAY);
-	oi_byte_tx(index);
+	uint8_t command[2] = {OI_OPCODE_PLAY, index};
+	oi_command_tx(command, sizeof(command));
 }
 
 
@@ -143,8 +819,8 @@ void go_charge(void) {
 	char charging_state=0;
 	
 	//Calling demo that will cause Create to seek out home base
-	oi_byte_tx(OI_OPCODE_MAX);
-	oi_byte_tx(0x01);
+	uint8_t command[2] = {OI_OPCODE_MAX, 0x01};
+	oi_command_tx(command, sizeof(command));
 	
 	//Control is returned immediately, so need to check for docking status
 	DDRB &= ~0x80; //Setting pin7 to input
@@ -159,10 +835,94 @@ void go_charge(void) {
 
 // Transmit a byte of data over the serial connection to the Create
 void oi_byte_tx(unsigned char value) {
-	// Wait until the transmit buffer is empty
+	oi_command_tx(&value, 1);
+}
+
+
+
+/// Queues a whole command for transmission to the Create
+/**
+* Waits only until the transmit queue has room for the entire command, then queues it in one go.
+* The USART1 data register empty interrupt sends the bytes, so commands are never interleaved.
+* @bytes  the command: opcode followed by its data bytes
+* @length number of bytes in the command, at most OI_TX_BUFFER_SIZE - 1
+*/
+void oi_command_tx(const uint8_t *bytes, uint8_t length) {
+	// Wait for room for the whole command; the interrupt keeps draining the queue
+	while (!oi_command_try_tx(bytes, length));
+}
+
+
+
+/// Queues a whole command for transmission to the Create if it fits now
+/**
+* Never waits, so it can be used from an interrupt handler.
+* @bytes  the command: opcode followed by its data bytes
+* @length number of bytes in the command, at most OI_TX_BUFFER_SIZE - 1
+* @return 1 if the command was queued, 0 if the queue had no room for it
+*/
+uint8_t oi_command_try_tx(const uint8_t *bytes, uint8_t length) {
+	uint8_t i;
+	
+	uint8_t sreg = SREG;
+	cli();
+	if ((uint8_t) (OI_TX_BUFFER_SIZE - 1 - oi_tx_queued()) < length) {
+		SREG = sreg;
+		return 0;
+	}
+	for (i = 0; i < length; i++) {
+		oi_tx_buffer[oi_tx_head] = bytes[i];
+		oi_tx_head = (oi_tx_head + 1) & (OI_TX_BUFFER_SIZE - 1);
+	}
+	uint8_t queued = oi_tx_queued();
+	if (queued > oi_tx_high_water_mark) {
+		oi_tx_high_water_mark = queued;
+	}
+	UCSR1B |= (1 << UDRIE); // start (or keep) the interrupt draining the queue
+	SREG = sreg;
+	return 1;
+}
+
+
+
+/// Blocks until every queued byte has been handed to the USART
+void oi_tx_flush(void) {
+	while (UCSR1B & (1 << UDRIE)); // the interrupt disables itself once the queue is empty
 	while (!(UCSR1A & (1 << UDRE)));
+}
+
+
 
-	UDR1 = value;
+/// Number of bytes currently waiting in the transmit queue
+uint8_t oi_tx_queued(void) {
+	return (oi_tx_head - oi_tx_tail) & (OI_TX_BUFFER_SIZE - 1);
+}
+
+
+
+/// Largest number of bytes that have been waiting in the transmit queue since the last reset
+/**
+* Used to size OI_TX_BUFFER_SIZE.
+* @reset 1 to start a new measurement after reading, 0 to keep the current one
+*/
+uint8_t oi_tx_high_water(uint8_t reset) {
+	uint8_t mark = oi_tx_high_water_mark;
+	if (reset) {
+		oi_tx_high_water_mark = 0;
+	}
+	return mark;
+}
+
+
+
+// Data register empty interrupt for USART1; sends the next queued byte
+ISR (USART1_UDRE_vect) {
+	if (oi_tx_head == oi_tx_tail) {
+		UCSR1B &= ~(1 << UDRIE); // queue empty, stop until the next command is queued
+		return;
+	}
+	OI_UDR1_WRITE(oi_tx_buffer[oi_tx_tail]);
+	oi_tx_tail = (oi_tx_tail + 1) & (OI_TX_BUFFER_SIZE - 1);
 }
 
 
@@ -172,5 +932,5 @@ unsigned char oi_byte_rx(void) {
 	// wait until a byte is received (Receive Complete flag, RXC, is set)
 	while (!(UCSR1A & (1 << RXC)));
 
-	return UDR1;
+	return OI_UDR1_READ();
 }
@@ -71,6 +71,16 @@
 // Contains Packets 7-42
 #define OI_SENSOR_PACKET_GROUP6 6
 
+// First byte of every sensor stream frame
+#define OI_STREAM_HEADER 19
+// Largest stream payload (packet ids and data bytes) the frame parser accepts; the link rate may allow less
+#define OI_STREAM_MAX_PAYLOAD 64
+// Most packet ids that can be registered with oi_set_packets(...)
+#define OI_MAX_PACKET_LIST 36
+
+// Size of the transmit queue in bytes (power of two); check oi_tx_high_water(...) before shrinking it
+#define OI_TX_BUFFER_SIZE 128
+
 #define MIN(a,b) ((a < b) ? (a) : (b))
 #define MAX(a,b) ((a > b) ? (a) : (b))
 
@@ -83,42 +93,27 @@
 #define PIN_6 0x40
 #define PIN_7 0x80
 
+// USART1 data register access. The host simulator (sim/) supplies its own versions in its <avr/io.h>.
+#ifndef OI_UDR1_WRITE
+#define OI_UDR1_WRITE(value) (UDR1 = (value))
+#define OI_UDR1_READ()       (UDR1)
+#endif
+
 /// iRobot Create Sensor Data
+/// Multi-byte fields come first so every field is naturally aligned; each field is written directly by the packet decoder.
 typedef struct {
-	// Sensor statuses (booleans)
-	uint8_t bumper_right : 1;
-	uint8_t bumper_left : 1;
-	uint8_t wheeldrop_right : 1;
-	uint8_t wheeldrop_left : 1;
-	uint8_t wheeldrop_caster : 1;
-	uint8_t wall; // not virtual wall
-	uint8_t cliff_left;
-	uint8_t cliff_frontleft;
-	uint8_t cliff_frontright;
-	uint8_t cliff_right;
-	uint8_t virtual_wall; // omni-directional IR sensor
-	
-	// Over current information
-	uint8_t overcurrent_ld1 : 1;
-	uint8_t overcurrent_ld0 : 1;
-	uint8_t overcurrent_ld2 : 1;
-	uint8_t overcurrent_driveright : 1;
-	uint8_t overcurrent_driveleft : 1;
-
-	uint16_t unused_bytes;
-	
-	uint8_t infrared_byte;
-	uint8_t button_play : 2;
-	uint8_t button_advance : 1;
+	// Frame information
+	uint32_t frame_number;  // increases by one for every sensor frame received
+	uint32_t timestamp;     // clock_ms() when the frame was received
+	int32_t distance_total; // running sum of distance over all frames, in millimeters
+	int32_t angle_total;    // running sum of angle over all frames, in degrees
 
-	int16_t distance; // in millimeters
-	int16_t angle;    // in degrees; counterclockwise is positive; clockwise is negative
+	int16_t distance; // in millimeters, since the previous update
+	int16_t angle;    // in degrees, since the previous update; counterclockwise is positive; clockwise is negative
 
 	// Battery information
-	uint8_t charging_state;
 	uint16_t voltage; // mV
 	int16_t current; // mA
-	int8_t temperature; // Celcius
 	uint16_t charge;
 	uint16_t capacity; // mA-hrs
 	
@@ -129,16 +124,49 @@ typedef struct {
 	uint16_t cliff_frontright_signal;
 	uint16_t cliff_right_signal;
 	
-	// Cargo bay info
-	uint8_t cargo_bay_io0 : 1;
-	uint8_t cargo_bay_io1 : 1;
-	uint8_t cargo_bay_io2 : 1;
-	uint8_t cargo_bay_io3 : 1;
-	uint8_t cargo_bay_baud : 1;
 	uint16_t cargo_bay_voltage;
 	
-	uint8_t internal_charger_on : 1;
-	uint8_t home_base_charger_on : 1;
+	int16_t requested_velocity;
+	int16_t requested_radius;
+	int16_t requested_right_velocity;
+	int16_t requested_left_velocity;
+
+	// Sensor statuses (booleans)
+	uint8_t bumper_right;
+	uint8_t bumper_left;
+	uint8_t wheeldrop_right;
+	uint8_t wheeldrop_left;
+	uint8_t wheeldrop_caster;
+	uint8_t wall; // not virtual wall
+	uint8_t cliff_left;
+	uint8_t cliff_frontleft;
+	uint8_t cliff_frontright;
+	uint8_t cliff_right;
+	uint8_t virtual_wall; // omni-directional IR sensor
+	
+	// Over current information (booleans)
+	uint8_t overcurrent_ld1;
+	uint8_t overcurrent_ld0;
+	uint8_t overcurrent_ld2;
+	uint8_t overcurrent_driveright;
+	uint8_t overcurrent_driveleft;
+	
+	uint8_t infrared_byte;
+	uint8_t button_play;
+	uint8_t button_advance;
+
+	uint8_t charging_state;
+	int8_t temperature; // Celcius
+	
+	// Cargo bay info (booleans)
+	uint8_t cargo_bay_io0;
+	uint8_t cargo_bay_io1;
+	uint8_t cargo_bay_io2;
+	uint8_t cargo_bay_io3;
+	uint8_t cargo_bay_baud;
+	
+	uint8_t internal_charger_on;
+	uint8_t home_base_charger_on;
 	
 	uint8_t oi_mode; // off, passive, safe, full
 	
@@ -146,10 +174,6 @@ typedef struct {
 	uint8_t song_playing;
 	
 	uint8_t number_packets;
-	int16_t requested_velocity;
-	int16_t requested_radius;
-	int16_t requested_right_velocity;
-	int16_t requested_left_velocity;
 } oi_t;
 
 typedef oi_t oi_sensors_t;
@@ -162,9 +186,50 @@ void oi_init(oi_t *self);
 
 void oi_free(oi_t *self);
 
+/// \brief Switch the Create and USART1 to the fastest link rate that passes a sensor round trip.
+/// Reports the rate, bytes/sec and round-trip latency on the serial console. Called by oi_init(...).
+/// \return the baud rate in use (28800 if no faster rate works)
+unsigned long oi_negotiate_baud(void);
+
+/// \brief Average sensor round trip at the rate oi_negotiate_baud() kept, in microseconds (0 if none was kept)
+unsigned long oi_link_latency(void);
+
 /// Update the Create. This will update all the sensor data.
+/// While the sensor stream is running this copies the latest streamed frame and never blocks.
 void oi_update(oi_t *self);
 
+/// \brief Copy the latest streamed sensor frame without blocking or disabling interrupts
+/// \param dest struct to receive the frame; frames are never torn
+void oi_snapshot(oi_t *dest);
+
+/// \brief Check whether sensor data is too old to act on
+/// \param self sensor data from oi_update(...) or oi_snapshot(...)
+/// \param max_age_ms oldest acceptable frame in milliseconds
+/// \return 1 if the data is older than max_age_ms
+uint8_t oi_is_stale(const oi_t *self, unsigned long max_age_ms);
+
+/// \brief Register the sensor packets that oi_update(...) fetches, instead of the full group 6
+/// \param packets list of single packet ids (7-42), kept until the next call; NULL restores the default drive set
+/// \param count number of ids in the list; NULL with 0 polls all of group 6 when the stream is not running
+/// \return the number of ids registered, 0 if the list was rejected because its stream frame would not fit in the
+/// 15 ms stream period at the negotiated link rate (or OI_STREAM_MAX_PAYLOAD); the registered list is kept then
+uint8_t oi_set_packets(const uint8_t *packets, uint8_t count);
+
+/// \brief Start streaming the registered sensor packets from the Create (one frame every 15 ms)
+/// \param self sensor data used to seed the fields that are not part of the stream
+void oi_stream_start(oi_t *self);
+
+/// Pause the sensor stream; oi_update(...) goes back to polling the Create
+void oi_stream_stop(void);
+
+/// \brief Feed one received byte to the stream frame parser. Called from the USART1 receive interrupt.
+/// \param value the byte received from the Create
+/// \return 1 if the byte completed a frame with a valid checksum, 0 otherwise
+uint8_t oi_stream_parse(uint8_t value);
+
+/// \brief Number of stream frames dropped because of a bad length, checksum or unknown packet
+uint16_t oi_stream_errors(void);
+
 /// \brief Set the LEDS on the Create
 /// \param play_led 0=off, 1=on
 /// \param advance_led 0=off, 1=on
@@ -177,10 +242,41 @@ void oi_set_leds(uint8_t play_led, uint8_t advance_led, uint8_t power_color, uin
 /// \param linear velocity in mm/s values range from -500 -> 500 of left wheel
 void oi_set_wheels(int16_t right_wheel, int16_t left_wheel);
 
+#define OI_DRIVE_MAX_RADIUS 2000     // largest turn radius the Create accepts, mm
+#define OI_DRIVE_STRAIGHT   0x8000   // radius that drives straight
+#define OI_DRIVE_SPIN_CCW   1        // radius that spins in place counterclockwise
+#define OI_DRIVE_SPIN_CW    (-1)     // radius that spins in place clockwise
+
+/// \brief Drive along a circle; the Create works out the wheel speeds
+/// \param velocity average speed of the wheels in mm/s, -500 -> 500; negative drives backwards
+/// \param radius turn radius in mm, -2000 -> 2000, positive turns left; or one of the OI_DRIVE_ special values
+void oi_drive(int16_t velocity, int16_t radius);
+
 /// \brief Transmit a byte of data over the serial connection to the Create 
 /// \param value 8-bit value to transmit to the Create
 void oi_byte_tx(unsigned char value);
 
+/// \brief Queue a whole command for the Create. Returns as soon as it is queued; an interrupt sends it.
+/// \param bytes opcode followed by its data bytes; never interleaved with another command
+/// \param length number of bytes, at most OI_TX_BUFFER_SIZE - 1
+void oi_command_tx(const uint8_t *bytes, uint8_t length);
+
+/// \brief Queue a whole command for the Create only if there is room now; safe to call from an interrupt
+/// \param bytes opcode followed by its data bytes
+/// \param length number of bytes
+/// \return 1 if queued, 0 if the queue was too full
+uint8_t oi_command_try_tx(const uint8_t *bytes, uint8_t length);
+
+/// Block until every queued command has been handed to the USART
+void oi_tx_flush(void);
+
+/// \brief Number of bytes waiting in the transmit queue
+uint8_t oi_tx_queued(void);
+
+/// \brief Largest number of bytes queued at once since the last reset
+/// \param reset 1 to start a new measurement after reading
+uint8_t oi_tx_high_water(uint8_t reset);
+
 /// \brief Receive a byte of data from the Create serial connection. Blocks 
 /// until a byte is received.
 /// \return 8-bit value returned from the Create
@@ -6,67 +6,115 @@
  */ 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "util.h"
 #include "lcd.h"
-#include <math.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 #include "irsensor.h"
 #include "serial.h"
 #include "servo.h"
+#include "calibration.h"
+#include "grid.h"
+#include "telemetry.h"
+#include "track.h"
+#include "ping.h"
 
-typedef struct { //a struct that holds a scanned object
-	int degreePosition; //the object's position relative to the servo rotation
-	int cmDistance; //distance from sensor in cm
-	int cmWidth; //object's actual width in cm
-	int scannedDegrees; //number of degrees for which the object was detected
-	int isValid; //1 or 0 - determines whether or not object is a remainder from previous scans
-} Object;
+#define PING_IDLE 0 //no measurement started
+#define PING_RISING 1 //pulse sent, waiting for the echo to start
+#define PING_FALLING 2 //echo started, waiting for it to end
+#define PING_DONE 3 //echo measured or timed out
+#define PING_TIMEOUT_MS 30 //longest echo the sensor sends (18.5 ms) plus its holdoff, with margin
+
+//sweepScan stages, for the timing report
+#define SCAN_SERVO 0
+#define SCAN_IR 1
+#define SCAN_PING 2
+#define SCAN_PROCESS 3
+#define SCAN_STAGES 4
+#define SCAN_POSITIONS 180 //servo positions of a scan, one per degree
+#define SCAN_COARSE_STEP 6 //degrees between the samples of adaptiveScan's coarse sweep
+#define SCAN_JUMP_CM 15 //distance change between coarse samples that may hide an edge
 
 //variables used by the interrupt to determine time between pulses
 volatile unsigned long rising_time = 0;
 volatile unsigned long falling_time = 0;
-volatile unsigned overflows = 0;
-volatile unsigned new_overflows = 0;
-volatile unsigned long delta = 0;
+volatile unsigned overflows = 0; //timer 1 overflows, the upper half of the 32-bit capture times
+volatile unsigned long delta = 0; //echo length in timer 1 ticks
+static volatile uint8_t pingState = PING_IDLE;
+static volatile uint8_t pingTimedOut = 0;
+static unsigned long pingStarted; //clock_ms() when the pulse was sent
 
-//various data used to keep track of ISR behavior
-int ISRruns = 0;
-int pulses = 0;
 volatile unsigned long pingDistance = 0;
+static unsigned long scanStageTicks[SCAN_STAGES]; //timer 1 ticks the last scan waited on each stage
+static unsigned int scanSamples; //servo positions the last scan sampled
+static unsigned int scanMark; //TCNT1 when time was last charged to a stage
 int quantization; //quanitzation factor between 0 and 1023 read from ADC
 int IRdistance = 0; //quantization factor converted to distance using function
 
+#define MAX_WIDTH_DEGREES 170 //widest angle the width formula is evaluated at - tan grows without bound toward 180
+
+//tan(degrees * 3.14 / 360) scaled by 1024, for the angular diameter formula
+static const uint16_t halfAngleTan[MAX_WIDTH_DEGREES + 1] PROGMEM = {
+	0, 9, 18, 27, 36, 45, 54, 63, 72, 81, 90, 99,
+	108, 117, 126, 135, 144, 153, 162, 171, 180, 190, 199, 208,
+	218, 227, 236, 246, 255, 265, 274, 284, 293, 303, 313, 323,
+	333, 342, 352, 362, 373, 383, 393, 403, 413, 424, 434, 445,
+	456, 466, 477, 488, 499, 510, 521, 533, 544, 556, 567, 579,
+	591, 603, 615, 627, 639, 652, 665, 677, 690, 703, 717, 730,
+	743, 757, 771, 785, 799, 814, 829, 844, 859, 874, 889, 905,
+	921, 938, 954, 971, 988, 1005, 1023, 1041, 1060, 1078, 1097, 1117,
+	1136, 1156, 1177, 1198, 1219, 1241, 1263, 1286, 1309, 1333, 1358, 1382,
+	1408, 1434, 1461, 1488, 1517, 1545, 1575, 1606, 1637, 1669, 1702, 1736,
+	1771, 1808, 1845, 1884, 1923, 1964, 2007, 2051, 2096, 2144, 2193, 2244,
+	2296, 2351, 2408, 2468, 2530, 2595, 2663, 2734, 2808, 2886, 2968, 3054,
+	3145, 3240, 3342, 3449, 3562, 3683, 3812, 3949, 4095, 4253, 4422, 4604,
+	4801, 5015, 5248, 5503, 5783, 6093, 6435, 6818, 7248, 7734, 8289, 8929,
+	9674, 10552, 11604
+};
+
 
 /// Keep track of timer overflows
 /**
- * Keeps track of total timer1 overflows
+ * Keeps track of total timer1 overflows, which extend the 16-bit capture times to 32 bits
  * @param TIMER1_OVF_vect the vector tracking timer overflows
  * 
  */
 ISR (TIMER1_OVF_vect) {
-	new_overflows++; //count total overflows
+	overflows++; //count total overflows
+}
+
+// Time of the latest capture, extended to 32 bits with the overflow count - call from the capture interrupt
+static unsigned long captureTime(void) {
+	unsigned int capture = ICR1;
+	unsigned int high = overflows;
+	
+	if ((TIFR & 0x04) && capture < 0x8000) { //the timer wrapped before the capture, but the overflow interrupt hasn't run yet
+		high++;
+	}
+	return ((unsigned long) high << 16) | capture;
 }
 
 /// Keep track of timer capture events
 /**
- * Keeps track of timer capture events and creates the delta value used to calculate actual distance
+ * Records the start of the echo, switches to the falling edge and returns; the next capture ends the
+ * echo and publishes its length in delta
  * @param TIMER1_CAPT_vect the vector monitoring timer capture events
  */
 ISR (TIMER1_CAPT_vect) {
-	ISRruns++;
-	if ((TCCR1B & 0b01000000) == 0b01000000) {
-		rising_time = ICR1; //catch rising time
+	if (pingState == PING_RISING) {
+		rising_time = captureTime(); //catch rising time
 		TCCR1B &= 0b10111111; //switch to react on falling edge
+		TIFR = 0x20; //changing the edge can raise a false capture
+		pingState = PING_FALLING;
 	}
-	while(ICR1 == rising_time) {
-		wait_ms(1); //wait until ICR1 value detects falling edge
-	}
-	if ((TCCR1B & 0b01000000) == 0b00000000) {
-		falling_time = ICR1;  //catch falling edge
+	else if (pingState == PING_FALLING) {
+		falling_time = captureTime(); //catch falling edge
 		delta = falling_time - rising_time; //calculate time between high and low
-		TCCR1B |= 0b01000000; //switch to react on rising edge
+		TCCR1B |= 0b01000000; //switch back to react on rising edge
+		pingState = PING_DONE;
 	}
-	TCCR1B |= 0b01000000; //ensure that rising edge is detected
 }
 
 /// Sends a single pulse from the ping sensor
@@ -75,16 +123,72 @@ ISR (TIMER1_CAPT_vect) {
  * 
  */
 void send_pulse() {
-	TIMSK &= 0xDB; //disable IC interrupt
+	unsigned int start;
+	
+	TIMSK &= 0xDF; //disable IC interrupt, the pulse itself would be captured
 	DDRD |= 0x10; //PD4 to output
 	PORTD |= 0x10; //PD4 to high
-	wait_ms(1); //wait
+	start = TCNT1;
+	while ((uint16_t) (TCNT1 - start) < 2); //hold for 4-8 us, timer 1 ticks every 4 us
 	PORTD &= 0xEF; //PD4 to low
-	wait_ms(1);
 	DDRD &= 0xEF; //PD4 to input
-	TIFR |= 0x20; //Clear IC flag
-	TIMSK |= 0x24; //re-enable IC interrupt
-	wait_ms(1);
+	TCCR1B |= 0b01000000; //the echo starts with a rising edge
+	TIFR = 0x20; //Clear IC flag
+	TIMSK |= 0x20; //re-enable IC interrupt
+}
+
+/// Starts a ping measurement without waiting for it
+/**
+ * Sends a pulse; the capture interrupt measures the echo in the background. Poll ping_ready() to
+ * find out when it is done.
+ * @return 1 if the pulse was sent, 0 if the previous measurement hasn't finished
+ */
+char ping_start() {
+	if (pingState == PING_RISING || pingState == PING_FALLING) {
+		if (!ping_ready()) {
+			return 0;
+		}
+	}
+	pingTimedOut = 0;
+	pingStarted = clock_ms();
+	pingState = PING_RISING;
+	send_pulse();
+	return 1;
+}
+
+/// Checks whether the measurement started by ping_start() has finished
+/**
+ * A measurement finishes when the echo ends, or after PING_TIMEOUT_MS if the echo never comes
+ * (e.g. the sensor is unplugged), which sets the timeout flag
+ * @return 1 if the measurement is done and delta holds its result
+ */
+char ping_ready() {
+	char ready;
+	uint8_t interrupts = SREG;
+	
+	cli(); //the capture interrupt must not finish the echo while it is being timed out
+	if ((pingState == PING_RISING || pingState == PING_FALLING) && clock_ms() - pingStarted > PING_TIMEOUT_MS) {
+		TIMSK &= 0xDF; //ignore a late echo
+		TCCR1B |= 0b01000000;
+		pingTimedOut = 1;
+		pingState = PING_DONE;
+	}
+	ready = (pingState == PING_DONE || pingState == PING_IDLE);
+	SREG = interrupts;
+	return ready;
+}
+
+/// Whether the last measurement ended without an echo
+char ping_timed_out() {
+	return pingTimedOut;
+}
+
+/// Echo length of the last measurement
+/**
+ * @return the echo length in timer 1 ticks (4 us), PING_MAX_TICKS if the measurement timed out
+ */
+unsigned long ping_delta() {
+	return pingTimedOut ? PING_MAX_TICKS : delta;
 }
 
 /// Converts raw delta value to real distance
@@ -93,24 +197,40 @@ void send_pulse() {
  * @param delta the raw value determined by the ISR
  * @return distance the delta value converted to a distance in cm
  */
-int timeToDist(int delta) {
-	float distance = (delta*0.06972973)+3.6481622; //factor determined by calibration (robot 4)
-	int roundingError = distance; //avoid float rounding errors
-	if (distance - roundingError > 0.5) {
-		return distance+1; //if rounded down, add 1 to compensate
+int timeToDist(unsigned long delta) {
+	if (delta > PING_MAX_TICKS) {
+		delta = PING_MAX_TICKS; //the sensor never sends a longer echo
 	}
-	return distance;
+	//delta*scale + offset, both scaled by 2^20, rounded
+	return ((unsigned int) delta * calibration.pingScale + calibration.pingOffset + 524288UL) >> 20;
+}
+
+/// Calculates an object's width from its distance and angular size
+/**
+ * Uses the angular diameter formula, width = 2 * distance * tan(angle / 2), with a lookup table for tan
+ * @param cmDistance the object's distance in cm
+ * @param scannedDegrees the number of degrees for which the object was detected
+ * @return the object's width in cm
+ */
+int objectWidth(int cmDistance, int scannedDegrees) {
+	if (scannedDegrees > MAX_WIDTH_DEGREES) {
+		scannedDegrees = MAX_WIDTH_DEGREES;
+	}
+	if (scannedDegrees < 0) {
+		scannedDegrees = 0;
+	}
+	return (2L * cmDistance * pgm_read_word(&halfAngleTan[scannedDegrees])) >> 10;
 }
 
 /// A helper method that sends a pulse and measures distance
 /**
- * Sends a pulse from the ping sensor, determines delta, and converts into a distance in cm
- * @param delta the raw delta value from the ISR
- * @return distance the distance from the sensor in cm
+ * Sends a pulse from the ping sensor, waits for the echo, and converts its length into a distance in cm
+ * @return distance the distance from the sensor in cm, the sensor's maximum range if no echo came back
  */
-unsigned long ping_read(unsigned long delta) {
-	send_pulse(); //send a pulse and calculate delta
-	unsigned long distance = timeToDist(delta); //convert delta to cm
+unsigned long ping_read() {
+	while (!ping_start()); //let a measurement already in flight finish
+	while (!ping_ready());
+	unsigned long distance = timeToDist(ping_delta()); //convert delta to cm
 	return distance;
 }
 
@@ -123,7 +243,7 @@ void timer1_init() {
 	TCCR1A = 0x00;
 	TCCR1B = 0xC3; //noise canceler on, rising edge selected (bit 6), 64 prescaler
 	TCCR1C = 0x00; //do not use force output compare
-	TIMSK |= 0x20; //use interrupts - bit 2 high is timer 1 value is overflowed
+	TIMSK |= 0x24; //use interrupts - bit 5 for input capture, bit 2 for timer 1 overflow
 }
 
 /// Scans a 180 degree radius and determines the smallest object in sight
@@ -133,66 +253,35 @@ void timer1_init() {
  */
 void scanSmallestObj() {
 	int degrees = 0;
-	Object objects[10]; //holds scanned objects for later analysis
-	int objectCount = 0; //number of objects already scanned
-	int prevDetectionStatus = 0; //previous state of object detection
+	ObjectPool pool; //holds scanned objects for later analysis
 	move_servo(0); //move servo to starting position
 	wait_ms(1500); //wait for initializations to finish
-	int finalValuesCalculated = 1;
+	segmentBegin(&pool);
+	unsigned long started = clock_ms();
+	telemetryScanStart('s');
 	
 	while(degrees < 180) { //for one full rotation
 		move_servo(degrees); //sweep servo
 		wait_ms(10);
-		degrees++; //increments of 2 degrees
 		
-		ping_read(delta); //take ping sensor data
-		wait_ms(50); //wait for return pulse
-		int foundDelta = delta;
-		pingDistance = timeToDist(foundDelta); //convert ping data to cm
+		pingDistance = ping_read(); //take ping sensor data, in cm
 		
 		quantization = avgSensorResults(); //read from ADC channel 2 (IR sensor)
-		IRdistance = 2364.5*(pow(quantization, -0.888));	//convert quantization to distance in cm
+		IRdistance = irDistance(quantization);	//convert quantization to distance in cm
 		
-		int objectDetected = 0; //whether or not an object is being detected
-		
-		//int distDifference = abs(IRdistance-pingDistance); //determine the absolute value of the difference between sensor values
-		if (IRdistance < 85 && prevDetectionStatus == 0) { //if an object is near and was not previously being detected
-			objectDetected = 1; //an object is near
-			Object scannedObject; //create a new object struct
-			scannedObject.degreePosition = degrees; //set degrees to current servo position
-			scannedObject.scannedDegrees = 1; //currently been scanned for one degree
-			scannedObject.cmDistance = 0; //distance according to ping sensor
-			objects[objectCount] = scannedObject; //add object to objects array
-			objectCount++;	//increment object count by 1
-			prevDetectionStatus = objectDetected;
-			finalValuesCalculated = 0;
-		}
-		else if (IRdistance < 150 && prevDetectionStatus == 1) { //if an object is still being detected
-			objectDetected = 1;
-
-		}
-		else if (IRdistance > 150 && prevDetectionStatus == 1) { //if a large change in IRdistance has occurred (noise) but an object was being scanned
-			objectDetected = 1;	//ignore IRdistance and continue scanning object
-			prevDetectionStatus = 0; //if the large gap persists, assume object is no longer being scanned
-		}
-		if (objectDetected) { //if currently scanning an object
-			objects[objectCount-1].scannedDegrees++; //increase number of degrees scanned for each servo rotation
-			objects[objectCount-1].cmDistance += pingDistance;
-		}
-		if (objectDetected == 0 && finalValuesCalculated == 0) { //if the object is no longer being detected, perform final calculations
-			objects[objectCount-1].cmDistance = (objects[objectCount-1].cmDistance/objects[objectCount-1].scannedDegrees);
-			objects[objectCount-1].cmWidth = ((2*objects[objectCount-1].cmDistance) * tan(((objects[objectCount-1].scannedDegrees)*3.14)/360)); //calculate width using angular diameter formula
-			finalValuesCalculated = 1;
-		}
-		lprintf("Objects: %d\nDegrees: %d\nWidth: %d", objectCount, objects[objectCount-1].scannedDegrees, objects[objectCount-1].cmWidth); //FOR DEBUG ONLY
-		
-		
-		char toPrint[31]; //contains string to pass to putty
-		toPrint[0] = ' ';
-		sprintf(toPrint, "%d      %d      %lu     %d\n\r", degrees, IRdistance, pingDistance, objectDetected);
-		serial_putString(toPrint, 29); //send string to putty
+		segmentAdd(&pool, degrees, IRdistance, pingDistance);
+		telemetryScanStep(degrees, IRdistance, pingDistance); //readings to the host, if telemetry is on
+		degrees++; //increments of 1 degree
+	}
+	segmentEnd(&pool);
+	telemetryScanEnd(degrees, clock_ms() - started);
+	if (pool.count == 0) {
+		lprintf("No objects found");
+		return;
 	}
 	
+	Object *objects = pool.objects;
+	int objectCount = pool.count;
 	int smallestWidth = 1023; //used to determine smallest object
 	int index = 0; //current object index
 	int removedObjects = 0; //running count of objects thrown out due to size or distance
@@ -216,71 +305,235 @@ void scanSmallestObj() {
 	move_servo(objects[index].degreePosition); //point to smallest object
 }
 
-/// Scans a 180 degree radius, adding all detected objects to the given container
+// Starts timing a scan, and its telemetry
+static void scanBegin(char kind) {
+	memset(scanStageTicks, 0, sizeof(scanStageTicks));
+	scanSamples = 0;
+	scanMark = TCNT1;
+	telemetryScanStart(kind);
+}
+
+// Timer 1 ticks the last scan took
+static unsigned long scanTotalTicks(void) {
+	unsigned long total = 0;
+	
+	for (uint8_t i = 0; i < SCAN_STAGES; i++) {
+		total += scanStageTicks[i];
+	}
+	return total;
+}
+
+// Finishes a scan's telemetry
+static void scanEnd(void) {
+	telemetryScanEnd(scanSamples, scanTotalTicks() / 250);
+}
+
+// Adds the timer 1 ticks since the last charge to a scan stage - call often, the timer wraps every 262 ms
+static void scanCharge(uint8_t stage) {
+	unsigned int now = TCNT1;
+	
+	scanStageTicks[stage] += (uint16_t) (now - scanMark);
+	scanMark = now;
+}
+
+// Waits for the servo to settle, charging the wait to the servo stage
+static void scanServoWait(unsigned long servoReady) {
+	while ((long) (clock_ms() - servoReady) < 0) { //servo still moving
+		scanCharge(SCAN_SERVO);
+	}
+}
+
+// Reads the IR sensor for one step - the filter window is shorter than the servo's settle time, so it already
+// holds only conversions taken at this step
+static int scanIR(void) {
+	scanSamples++;
+	quantization = irFiltered(); //IR sensor, ADC channel 2
+	scanCharge(SCAN_IR);
+	return irDistance(quantization); //convert quantization to distance in cm
+}
+
+// Waits for the echo of a ping already started, charging the wait to the ping stage
+static unsigned long scanPing(void) {
+	while (!ping_ready()) {
+		scanCharge(SCAN_PING);
+	}
+	return timeToDist(ping_delta()); //convert ping data to cm
+}
+
+/// Scans a 180 degree radius, adding all detected objects to the given pool
 /**
- * Takes 180 data points from the ping sensor, converts all values into cm, and puts all objects into the given container
- * @param objects an array of objects used to store any data collected by sweepScan
+ * Takes 180 data points from the IR sensor, measures the distance with the ping sensor where the segmenter asks for it,
+ * and segments the steps into objects as they come. The stages overlap: the servo moves to the next position while
+ * the echo is in flight and the step is processed, so a step without an object takes about as long as the servo.
+ * @param pool the pool the objects found are put into, emptied first
  */
-void sweepScan(Object objects[]) {
+void sweepScan(ObjectPool *pool) {
 	int degrees = 0;
-	int objectCount = 0; //number of objects already scanned
-	int prevDetectionStatus = 0; //previous state of object detection
-	move_servo(0); //move servo to starting position
-	wait_ms(1000); //wait for initializations to finish
-	int finalValuesCalculated = 1;
+	unsigned long servoReady = clock_ms() + servo_set(0); //move servo to starting position
 	
+	segmentBegin(pool);
+	scanBegin('r');
 	while(degrees < 180) { //for one full rotation
-		move_servo(degrees); //sweep servo
-		degrees++; //increments of 2 degrees
-		
-		ping_read(delta); //take ping sensor data
-		wait_ms(10); //wait for return pulse
-		int foundDelta = delta;
-		pingDistance = timeToDist(foundDelta); //convert ping data to cm
-		
-		quantization = avgSensorResults(); //read from ADC channel 2 (IR sensor)
-		IRdistance = 2364.5*(pow(quantization, -0.888));	//convert quantization to distance in cm
+		int pingCm = -1; //no reading, unless the step is pinged
 		
-		int objectDetected = 0; //whether or not an object is being detected
+		scanServoWait(servoReady);
+		IRdistance = scanIR();
 		
-		//int distDifference = abs(IRdistance-pingDistance); //determine the absolute value of the difference between sensor values
-		if (IRdistance < 85 && prevDetectionStatus == 0) { //if an object is near and was not previously being detected
-			objectDetected = 1; //an object is near
-			Object scannedObject; //create a new object struct
-			scannedObject.degreePosition = degrees; //set degrees to current servo position
-			scannedObject.scannedDegrees = 1; //currently been scanned for one degree
-			scannedObject.cmDistance = 0; //distance according to ping sensor
-			scannedObject.isValid = 1;
-			objects[objectCount] = scannedObject; //add object to objects array
-			objectCount++;	//increment object count by 1
-			prevDetectionStatus = objectDetected;
-			finalValuesCalculated = 0;
+		char needsPing = segmentNeedsPing(pool, IRdistance);
+		if (needsPing) {
+			ping_start();
 		}
-		else if (IRdistance < 150 && prevDetectionStatus == 1) { //if an object is still being detected
-			objectDetected = 1;
-
+		if (degrees < 179) {
+			servoReady = clock_ms() + servo_set(degrees + 1); //sweep servo while the echo is in flight, the ping sensor's wide beam doesn't mind
 		}
-		else if (IRdistance > 150 && prevDetectionStatus == 1) { //if a large change in IRdistance has occurred (noise) but an object was being scanned
-			objectDetected = 1;	//ignore IRdistance and continue scanning object
-			prevDetectionStatus = 0; //if the large gap persists, assume object is no longer being scanned
+		if (needsPing) {
+			pingDistance = scanPing();
+			pingCm = pingDistance;
 		}
-		if (objectDetected) { //if currently scanning an object
-			objects[objectCount-1].scannedDegrees++; //increase number of degrees scanned for each servo rotation
-			objects[objectCount-1].cmDistance += pingDistance;
+		segmentAdd(pool, degrees, IRdistance, pingCm);
+		gridScanStep(degrees, IRdistance, pingCm); //remember the field as well
+		telemetryScanStep(degrees, IRdistance, pingCm);
+		degrees++; //increments of 1 degree
+		scanCharge(SCAN_PROCESS);
+	}
+	segmentEnd(pool);
+	scanEnd();
+}
+
+// Class of an IR distance for the object detection: 2 starts an object, 1 continues one, 0 ends it
+static uint8_t scanClass(uint8_t cm) {
+	return (cm < SEGMENT_START_CM) ? 2 : (cm < SEGMENT_CONTINUE_CM) ? 1 : 0;
+}
+
+// Whether the readings at two coarse positions differ enough that an edge may lie between them
+static char scanJump(const uint8_t irCm[], const int16_t pingCm[], uint8_t a, uint8_t b, char objectOpen) {
+	uint8_t classA = scanClass(irCm[a]);
+	uint8_t classB = scanClass(irCm[b]);
+	
+	if (classA != classB) {
+		return classA == 2 || classB == 2 || objectOpen; //something only in continuing range can't start an object
+	}
+	if (classA == 0) {
+		return 0; //nothing in range at either end
+	}
+	return abs(irCm[a] - irCm[b]) > SCAN_JUMP_CM || abs(pingCm[a] - pingCm[b]) > SCAN_JUMP_CM;
+}
+
+// Measures one servo position for adaptiveScan, pinging only when the IR sensor sees something the segmenter may use
+static void scanPosition(uint8_t position, uint8_t irCm[], int16_t pingCm[]) {
+	int ir;
+	
+	scanServoWait(clock_ms() + servo_set(position));
+	ir = scanIR();
+	irCm[position] = (ir > 255) ? 255 : ir;
+	if (scanClass(irCm[position])) {
+		ping_start();
+		pingCm[position] = scanPing();
+	}
+	gridScanStep(position, irCm[position], pingCm[position]); //only sampled positions, not the ones filled in afterwards
+	telemetryScanStep(position, irCm[position], pingCm[position]);
+	scanCharge(SCAN_PROCESS);
+}
+
+/// Scans a 180 degree radius in coarse steps, refining only where the readings change
+/**
+ * Samples every SCAN_COARSE_STEP degrees. Where two neighbouring samples differ - an object starts or ends, or its
+ * distance jumps - the degrees between them are sampled too, in the same direction as the sweep, so object edges and
+ * widths keep one degree precision. Degrees that weren't sampled take the reading of the sample before them. The
+ * objects found are the ones sweepScan would find, in a fraction of the samples when the field is mostly empty.
+ * @param pool the pool the objects found are put into, emptied first
+ */
+void adaptiveScan(ObjectPool *pool) {
+	uint8_t irCm[SCAN_POSITIONS]; //IR distance per servo position, 0 if not sampled
+	int16_t pingCm[SCAN_POSITIONS]; //ping distance per servo position, -1 where it wasn't pinged
+	uint8_t previous = 0;
+	uint8_t position = 0;
+	char objectOpen; //an object may have started and not ended yet
+	
+	memset(irCm, 0, sizeof(irCm));
+	for (uint8_t i = 0; i < SCAN_POSITIONS; i++) {
+		pingCm[i] = -1;
+	}
+	scanBegin('R');
+	scanPosition(0, irCm, pingCm);
+	objectOpen = (scanClass(irCm[0]) == 2);
+	while (position < SCAN_POSITIONS - 1) {
+		position = (previous + SCAN_COARSE_STEP < SCAN_POSITIONS - 1) ? previous + SCAN_COARSE_STEP : SCAN_POSITIONS - 1;
+		scanPosition(position, irCm, pingCm);
+		if (scanJump(irCm, pingCm, previous, position, objectOpen)) {
+			for (uint8_t fine = previous + 1; fine < position; fine++) { //go back and fill in the gap
+				scanPosition(fine, irCm, pingCm);
+			}
 		}
-		if (objectDetected == 0 && finalValuesCalculated == 0) { //if the object is no longer being detected, perform final calculations
-			objects[objectCount-1].cmDistance = (objects[objectCount-1].cmDistance/objects[objectCount-1].scannedDegrees);
-			objects[objectCount-1].cmWidth = ((2*objects[objectCount-1].cmDistance) * tan(((objects[objectCount-1].scannedDegrees)*3.14)/360)); //calculate width using angular diameter formula
-			finalValuesCalculated = 1;
+		if (scanClass(irCm[position]) != 1) {
+			objectOpen = (scanClass(irCm[position]) == 2);
 		}
-		//lprintf("Objects: %d\nDegrees: %d\nWidth: %d", objectCount, objects[objectCount-1].scannedDegrees, objects[objectCount-1].cmWidth); //FOR DEBUG ONLY
-		
-		
-		/*char toPrint[31]; //contains string to pass to putty
-		toPrint[0] = ' ';
-		sprintf(toPrint, "%d      %d      %lu     %d\n\r", degrees, IRdistance, pingDistance, objectDetected);
-		serial_putString(toPrint, 29); //send string to putty for debug
-		*/
+		previous = position;
+	}
+	
+	segmentBegin(pool);
+	for (position = 0; position < SCAN_POSITIONS; position++) { //segment like sweepScan, one degree at a time
+		if (irCm[position] == 0) {
+			irCm[position] = irCm[position - 1];
+			pingCm[position] = pingCm[position - 1];
+		}
+		segmentAdd(pool, position, irCm[position], pingCm[position]);
+	}
+	segmentEnd(pool);
+	scanCharge(SCAN_PROCESS);
+	scanEnd();
+}
+
+/// Checks the static tracks with one reading each instead of a full sweep
+/**
+ * Points the sensors at where each confirmed, static track should be and takes one IR and ping reading there - a
+ * servo move and an echo per object, against over a second for a sweep. Tracks that move, are new, or are out of
+ * view need a full scan to follow them.
+ * @return number of tracks that need a full scan
+ */
+uint8_t confirmScan(void) {
+	uint8_t needScan = 0;
+	
+	scanBegin('v');
+	for (uint8_t i = 0; i < TRACK_CAPACITY; i++) {
+		const Track *track = trackGet(i);
+		int degree, cm;
+		int seen = -1; //ping distance, -1 if the IR sensor saw nothing there
 		
+		if (!track->id) {
+			continue;
+		}
+		if (track->moving || track->hits < TRACK_CONFIRMED_HITS || !trackExpect(i, clock_ms(), &degree, &cm)) {
+			needScan++;
+			continue;
+		}
+		scanServoWait(clock_ms() + servo_set(degree));
+		IRdistance = scanIR();
+		if (IRdistance < SEGMENT_CONTINUE_CM) {
+			ping_start();
+			seen = scanPing();
+		}
+		telemetryScanStep(degree, IRdistance, seen);
+		trackConfirm(i, clock_ms(), seen);
+		scanCharge(SCAN_PROCESS);
+	}
+	scanEnd();
+	return needScan;
+}
+
+/// Sends the time the last scan spent waiting on each stage over serial
+/**
+ * Only the time a stage held the scan up is counted, e.g. echo time spent while the servo is still moving counts as servo
+ */
+void scanTimingReport() {
+	char report[128];
+	uint16_t dropped = telemetryDropped(1);
+	
+	sprintf(report, "Scan took %lu ms, %u samples: servo %lu, IR %lu, ping %lu, processing %lu\n\r", scanTotalTicks() / 250, scanSamples,
+		scanStageTicks[SCAN_SERVO] / 250, scanStageTicks[SCAN_IR] / 250, scanStageTicks[SCAN_PING] / 250, scanStageTicks[SCAN_PROCESS] / 250);
+	serial_putString(report, strlen(report));
+	if (dropped) {
+		sprintf(report, "Telemetry dropped %u frames\n\r", dropped);
+		serial_putString(report, strlen(report));
 	}
-}
+}
\ No newline at end of file
@@ -5,21 +5,38 @@
  *  Author: robideau
  */ 
 
-typedef struct { //a struct that holds a scanned object
-	int degreePosition; //the object's position relative to the servo rotation
-	int cmDistance; //distance from sensor in cm
-	int cmWidth; //object's actual width in cm
-	int scannedDegrees; //number of degrees for which the object was detected
-	int isValid;
-} Object;
+#ifndef PING_H
+#define PING_H
+
+#include "segment.h"
+
+#define PING_MAX_TICKS 4625UL //echo the sensor sends when nothing is in range, 18.5 ms in timer 1 ticks
 
 void send_pulse(void);
 
-int timeToDist(int delta);
+char ping_start(void);
+
+char ping_ready(void);
+
+char ping_timed_out(void);
+
+unsigned long ping_delta(void);
+
+int timeToDist(unsigned long delta);
+
+int objectWidth(int cmDistance, int scannedDegrees);
 
 unsigned long ping_read(void);
 
 void timer1_init(void);
 
-void sweepScan(Object objects[]);
+void sweepScan(ObjectPool *pool);
+
+void adaptiveScan(ObjectPool *pool);
+
+uint8_t confirmScan(void);
+
+void scanTimingReport(void);
+
+#endif /* PING_H */
 
@@ -0,0 +1,191 @@
+/*
+ * pose.c
+ *
+ * Created: 10/17/2026 1:05:22 PM
+ */ 
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <string.h>
+#include "serial.h"
+#include "pose.h"
+
+
+//sin(0..90 degrees) in 256 steps, scaled by 16384
+static const int16_t sineTable[257] PROGMEM = {
+	0, 101, 201, 302, 402, 503, 603, 704, 804, 904, 1005, 1105,
+	1205, 1306, 1406, 1506, 1606, 1706, 1806, 1906, 2006, 2105, 2205, 2305,
+	2404, 2503, 2603, 2702, 2801, 2900, 2999, 3098, 3196, 3295, 3393, 3492,
+	3590, 3688, 3786, 3883, 3981, 4078, 4176, 4273, 4370, 4467, 4563, 4660,
+	4756, 4852, 4948, 5044, 5139, 5235, 5330, 5425, 5520, 5614, 5708, 5803,
+	5897, 5990, 6084, 6177, 6270, 6363, 6455, 6547, 6639, 6731, 6823, 6914,
+	7005, 7096, 7186, 7276, 7366, 7456, 7545, 7635, 7723, 7812, 7900, 7988,
+	8076, 8163, 8250, 8337, 8423, 8509, 8595, 8680, 8765, 8850, 8935, 9019,
+	9102, 9186, 9269, 9352, 9434, 9516, 9598, 9679, 9760, 9841, 9921, 10001,
+	10080, 10159, 10238, 10316, 10394, 10471, 10549, 10625, 10702, 10778, 10853, 10928,
+	11003, 11077, 11151, 11224, 11297, 11370, 11442, 11514, 11585, 11656, 11727, 11797,
+	11866, 11935, 12004, 12072, 12140, 12207, 12274, 12340, 12406, 12472, 12537, 12601,
+	12665, 12729, 12792, 12854, 12916, 12978, 13039, 13100, 13160, 13219, 13279, 13337,
+	13395, 13453, 13510, 13567, 13623, 13678, 13733, 13788, 13842, 13896, 13949, 14001,
+	14053, 14104, 14155, 14206, 14256, 14305, 14354, 14402, 14449, 14497, 14543, 14589,
+	14635, 14680, 14724, 14768, 14811, 14854, 14896, 14937, 14978, 15019, 15059, 15098,
+	15137, 15175, 15213, 15250, 15286, 15322, 15357, 15392, 15426, 15460, 15493, 15525,
+	15557, 15588, 15619, 15649, 15679, 15707, 15736, 15763, 15791, 15817, 15843, 15868,
+	15893, 15917, 15941, 15964, 15986, 16008, 16029, 16049, 16069, 16088, 16107, 16125,
+	16143, 16160, 16176, 16192, 16207, 16221, 16235, 16248, 16261, 16273, 16284, 16295,
+	16305, 16315, 16324, 16332, 16340, 16347, 16353, 16359, 16364, 16369, 16373, 16376,
+	16379, 16381, 16383, 16384, 16384
+};
+
+static Pose pose = {0, 0, 0}; //updated by every sensor frame, possibly from the USART interrupt
+
+/// Sine of a binary angle
+/**
+ * Looks the angle up in the quarter wave table and interpolates between neighboring entries
+ * @param angle binary angle, 2^32 is a full turn
+ * @return the sine scaled by 16384
+ */
+int16_t poseSin(uint32_t angle) {
+	uint16_t a = angle >> 16;
+	uint16_t q = a & 0x3FFF; //position within the quadrant
+	uint8_t index;
+	uint8_t fraction;
+	int16_t value;
+	
+	if (a & 0x4000) { //second and fourth quadrants run backwards through the table
+		q = 0x4000 - q;
+	}
+	if (q == 0x4000) {
+		value = pgm_read_word(&sineTable[256]);
+	}
+	else {
+		index = q >> 6;
+		fraction = q & 0x3F;
+		value = pgm_read_word(&sineTable[index]);
+		value += ((int16_t) pgm_read_word(&sineTable[index + 1]) - value) * fraction >> 6;
+	}
+	return (a & 0x8000) ? -value : value; //negative in the third and fourth quadrants
+}
+
+/// Cosine of a binary angle
+/**
+ * @param angle binary angle, 2^32 is a full turn
+ * @return the cosine scaled by 16384
+ */
+int16_t poseCos(uint32_t angle) {
+	return poseSin(angle + 0x40000000UL);
+}
+
+/// Direction of a point, as a binary angle
+/**
+ * Binary search on the sign of the cross product between the direction and the point, using the sine table
+ * @param y distance to the left
+ * @param x distance forward
+ * @return the angle from forward to the point, 65536 is a full turn, counterclockwise positive
+ */
+int16_t poseAtan2(int16_t y, int16_t x) {
+	int16_t low = -0x4000;
+	int16_t high = 0x4000;
+	int16_t middle;
+	
+	if (x < 0) { //search the half plane behind, then turn it around
+		return poseAtan2(-y, -x) + (int16_t) 0x8000;
+	}
+	while (high - low > 1) {
+		middle = low + (high - low) / 2;
+		if ((int32_t) y * poseCos((uint32_t) middle << 16) - (int32_t) x * poseSin((uint32_t) middle << 16) > 0) {
+			low = middle; //the point is further counterclockwise
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/// Integer square root
+/**
+ * Bit by bit, without multiplying - e.g. the length of a vector, or the speed that can still stop within a distance
+ * @param value the number to take the root of
+ * @return the root, rounded down
+ */
+unsigned long poseSqrt(unsigned long value) {
+	unsigned long root = 0;
+	unsigned long bit = 1UL << 30;
+	
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+/// Add one sensor frame's motion to the pose
+/**
+ * Moves the pose along the heading halfway through the frame's turn. Called for every sensor frame.
+ * The turn is multiplied out in unsigned arithmetic, which wraps like a binary angle should, so a frame
+ * that adds up more than 180 degrees (e.g. after a long blocking call) still turns the right way.
+ * @param distance distance traveled since the last frame, mm
+ * @param angle angle turned since the last frame, degrees counterclockwise
+ */
+void poseUpdate(int16_t distance, int16_t angle) {
+	uint32_t turn = (uint32_t) (int32_t) angle * BINARY_DEGREE;
+	uint32_t heading = pose.theta + (uint32_t) (int32_t) angle * (BINARY_DEGREE / 2); //average heading over the frame
+	
+	pose.x += ((int32_t) distance * poseCos(heading) + 32) >> 6; //scaled by 16384, kept in 1/256 mm
+	pose.y += ((int32_t) distance * poseSin(heading) + 32) >> 6;
+	pose.theta += turn;
+}
+
+/// Copy the current pose
+/**
+ * @param *dest where to copy the pose
+ */
+void poseGet(Pose *dest) {
+	uint8_t sreg = SREG;
+	cli(); //the pose is updated by the USART interrupt while streaming
+	*dest = pose;
+	SREG = sreg;
+}
+
+/// Make the current position the origin and the current heading zero
+void poseReset(void) {
+	uint8_t sreg = SREG;
+	cli();
+	pose.x = 0;
+	pose.y = 0;
+	pose.theta = 0;
+	SREG = sreg;
+}
+
+/// Heading of a pose in degrees
+/**
+ * @param *p the pose
+ * @return heading from -180 to 179 degrees, counterclockwise positive
+ */
+int poseHeading(const Pose *p) {
+	int heading = ((int32_t) (int16_t) (p->theta >> 16) * 360 + 32768) >> 16; //rounded
+	
+	return (heading == 180) ? -180 : heading; //just short of half a turn rounds up to it
+}
+
+/// Send the current pose over serial
+void poseReport(void) {
+	Pose p;
+	char poseString[72];
+	
+	poseGet(&p);
+	sprintf(poseString, "Pose: x %ld mm, y %ld mm, heading %d degrees\n\r", (long) (p.x >> 8), (long) (p.y >> 8), poseHeading(&p));
+	serial_putString(poseString, strlen(poseString));
+}
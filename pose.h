@@ -0,0 +1,38 @@
+/*
+ * pose.h
+ *
+ * Created: 10/17/2026 1:05:30 PM
+ */ 
+
+#ifndef POSE_H
+#define POSE_H
+
+#include <inttypes.h>
+
+#define BINARY_DEGREE 11930465L //one degree as a binary angle (2^32 / 360)
+
+typedef struct { //where the robot is, relative to where the pose was last reset
+	int32_t x; //forward from the origin, 1/256 mm
+	int32_t y; //left of the origin, 1/256 mm
+	uint32_t theta; //heading as a binary angle - 2^32 is a full turn, counterclockwise positive
+} Pose;
+
+void poseUpdate(int16_t distance, int16_t angle);
+
+void poseGet(Pose *dest);
+
+void poseReset(void);
+
+int poseHeading(const Pose *p);
+
+void poseReport(void);
+
+int16_t poseSin(uint32_t angle);
+
+int16_t poseCos(uint32_t angle);
+
+int16_t poseAtan2(int16_t y, int16_t x);
+
+unsigned long poseSqrt(unsigned long value);
+
+#endif /* POSE_H */
\ No newline at end of file
@@ -17,6 +17,14 @@
 #include "servo.h"
 #include "open_interface.h"
 #include "movement.h"
+#include "script.h"
+#include "pose.h"
+#include "hazard.h"
+#include "calibration.h"
+#include "colorCalibration.h"
+#include "grid.h"
+#include "telemetry.h"
+#include "track.h"
 #include <string.h>
 
 struct oi_t {
@@ -25,77 +33,152 @@ struct oi_t {
 	
 int degreeIntervals = 90; //intervals of rotation
 int distanceIntervals = 10; //forward and backward motion intervals	
+int scriptLoaded = 0; //whether the forward script has been uploaded to the Create
+#define ARC_RADIUS 300 //radius of the arc commands, mm
+#define ARC_LENGTH 471 //a quarter circle of ARC_RADIUS, mm
 	
 /// Takes keyboard inputs from putty
 /**
  * Takes keyboard inputs from putty - allows the user to control the robot using the home computer's keyboard
  * @param received the key pressed by the operator
- * @param currentObjects any objects currently held by the program's container
+ * @param *sensor_data the struct holding the robot's sensor data, initialized once by main
+ * @param currentObjects the pool that holds the objects found by the last scan
  */
-void takeDirectionInput(char received, Object currentObjects[]) {
-	
-	oi_t *sensor_data = oi_alloc();
-	oi_init(sensor_data);
-	
-	oi_set_wheels(0,0);
+void takeDirectionInput(char received, oi_t *sensor_data, ObjectPool *currentObjects) {
 	
 	if (received == 'w') { // w = forward
 		serial_putString("Moving forward...\n\r", 20);
-		moveForward(sensor_data, distanceIntervals);
-		oi_set_wheels(0, 0);
-		wait_ms(50);
+		motionQueueCommand(MOTION_TRANSLATE, distanceIntervals*10, 0);
+	}
+	if (received == 'W') { // W = forward using the Create's onboard script - returns while the robot drives
+		motionWait(sensor_data); //let queued motion finish first
+		if (!scriptLoaded) {
+			ScriptStep forward[] = {{SCRIPT_MOVE, distanceIntervals*10}};
+			Script script;
+			compileScript(&script, forward, 1, 200);
+			uploadScript(&script); //upload once, replay on every later press
+			scriptLoaded = 1;
+		}
+		serial_putString("Moving forward (script)...\n\r", 29);
+		playScript();
 	}
 	if (received == 's') { //s = backward
 		serial_putString("Moving backward...\n\r", 21);
-		moveBackward(sensor_data, -distanceIntervals);
-		oi_set_wheels(0, 0);
-		wait_ms(50);
+		motionQueueCommand(MOTION_TRANSLATE, -distanceIntervals*10, 0);
 	}
 	if (received == 'a') { // a = counterclockwise
 		serial_putString("Rotating counterclockwise 90 degrees...\n\r", 42);
-		rotateCounterClockwise(sensor_data, degreeIntervals);
-		oi_set_wheels(0, 0);
-		wait_ms(50);
+		motionQueueCommand(MOTION_ROTATE, degreeIntervals, 0);
 	}
 	if (received == 'q') {
 		serial_putString("Rotating counterclockwise 15 degrees...\n\r", 42);
-		rotateCounterClockwiseFine(sensor_data, degreeIntervals);
-		oi_set_wheels(0, 0);
-		wait_ms(50);
+		motionQueueCommand(MOTION_ROTATE, degreeIntervals/6, 0);
 	}
 	if (received == 'd') { // d = clockwise
 		serial_putString("Rotating clockwise 90 degrees...\n\r", 35);
-		rotateClockwise(sensor_data, -degreeIntervals);
-		oi_set_wheels(0, 0);
-		wait_ms(50);
+		motionQueueCommand(MOTION_ROTATE, -degreeIntervals, 0);
 	}
 	if (received == 'e') {
 		serial_putString("Rotating clockwise 15 degrees...\n\r", 35);
-		rotateClockwiseFine(sensor_data, -degreeIntervals);
-		oi_set_wheels(0, 0);
-		wait_ms(50);
+		motionQueueCommand(MOTION_ROTATE, -degreeIntervals/6, 0);
+	}
+	if (received == 'A') { // A = quarter circle forward and to the left
+		serial_putString("Arcing left...\n\r", 17);
+		motionQueueCommand(MOTION_ARC, ARC_LENGTH, ARC_RADIUS);
+	}
+	if (received == 'D') { // D = quarter circle forward and to the right
+		serial_putString("Arcing right...\n\r", 18);
+		motionQueueCommand(MOTION_ARC, ARC_LENGTH, -ARC_RADIUS);
 	}
-	if (received == 'r') { // r = scan for objects
+	if (received == 'x') { // x = stop and drop queued motion
+		serial_putString("Stopping...\n\r", 14);
+		motionStop();
+	}
+	if (received == 'r' || received == 'R') { // r = scan for objects, R = adaptive scan - coarse, refined at edges
 		serial_putString("Scanning...\n\r", 14);
-		sweepScan(currentObjects);
-		for (int i = 0; i < 20; i++) {
-			if (currentObjects[i].isValid) {
-				char* scanString = "*";
-				sprintf(scanString, "Object at %d degrees, %d cm away, %d cm wide\n\r", currentObjects[i].degreePosition, currentObjects[i].cmDistance, currentObjects[i].cmWidth);
-				wait_ms(10);		
-				serial_putString(scanString, 47);
-			}
+		motionWait(sensor_data); //scan from a standstill
+		if (received == 'r') {
+			sweepScan(currentObjects);
+		}
+		else {
+			adaptiveScan(currentObjects);
+		}
+		for (int i = 0; i < currentObjects->count; i++) {
+			Object *object = &currentObjects->objects[i];
+			char scanString[80];
+			sprintf(scanString, "Object at %d degrees, %d cm away, %d cm wide, %d%% confident\n\r", object->degreePosition, object->cmDistance, object->cmWidth, object->confidence);
+			wait_ms(10);		
+			serial_putString(scanString, strlen(scanString));
+		}
+		if (currentObjects->overflow) {
+			char overflowString[48];
+			sprintf(overflowString, "%d more objects didn't fit\n\r", currentObjects->overflow);
+			serial_putString(overflowString, strlen(overflowString));
+		}
+		scanTimingReport();
+		trackScan(currentObjects, clock_ms()); //follow the objects from scan to scan
+		trackReport();
+	}
+	if (received == 'v') { //v = quick check of the static tracks, without a full scan
+		char confirmString[64];
+		motionWait(sensor_data);
+		uint8_t needScan = confirmScan();
+		scanTimingReport();
+		trackReport();
+		if (needScan) {
+			sprintf(confirmString, "%d tracks need a full scan (r)\n\r", needScan);
+			serial_putString(confirmString, strlen(confirmString));
 		}
-		moveBackward(sensor_data, 0);
 	}
 	if (received == 'c') { //c = scan for colors -- used for calibration
 		char colorString[40];
+		oi_update(sensor_data); //take the latest streamed sensor frame
 		sprintf(colorString, "FL: %d   L: %d    R: %d   FR: %d\n\r", sensor_data->cliff_frontleft_signal, sensor_data->cliff_left_signal, sensor_data->cliff_right_signal, sensor_data->cliff_frontright_signal);
 		serial_putString(colorString, 40);
-		colorCheck(sensor_data->cliff_frontleft_signal, sensor_data->cliff_left_signal, sensor_data->cliff_right_signal, sensor_data->cliff_frontright_signal);
+		hazardReport(hazardEvaluate(sensor_data));
 	}
 	if (received == 't') { //t = play song
 		serial_putString("Playing song...\n\r", 18);
 		oi_play_song(0);
 	}
+	if (received == 'h') { //h = toggle heading hold for straight-line driving
+		setHeadingHold(!headingHoldEnabled());
+		if (headingHoldEnabled()) {
+			serial_putString("Heading hold on.\n\r", 19);
+		}
+		else {
+			serial_putString("Heading hold off.\n\r", 20);
+		}
+	}
+	if (received == 'p') { //p = report the pose
+		poseReport();
+	}
+	if (received == 'o') { //o = make the current pose the origin
+		serial_putString("Pose and map reset.\n\r", 22);
+		poseReset();
+		gridClear(); //the map and tracks were kept relative to the old origin
+		trackReset();
+	}
+	if (received == 'm') { //m = send the map the scans have built
+		gridDump();
+	}
+	if (received == 'b') { //b = toggle streaming binary scan telemetry
+		telemetryEnable(!telemetryEnabled());
+		if (telemetryEnabled()) {
+			serial_putString("Scan telemetry on.\n\r", 21);
+		}
+		else {
+			serial_putString("Scan telemetry off.\n\r", 22);
+		}
+	}
+	if (received == 'k') { //k = view or change this robot's calibration
+		motionWait(sensor_data); //typing the command would stall the motion engine
+		calibrationEdit();
+	}
+	if (received == 'C') { //C = measure the tape thresholds
+		char changed[64];
+		motionWait(sensor_data);
+		sprintf(changed, "%d tape thresholds set, press k and save to keep them.\n\r", colorCalibrate(sensor_data));
+		serial_putString(changed, strlen(changed));
+	}
 }
@@ -5,4 +5,4 @@
  *  Author: robideau
  */ 
 
-void takeDirectionInput(char received, Object currentObjects[]);
\ No newline at end of file
+void takeDirectionInput(char received, oi_t *sensor_data, ObjectPool *currentObjects);
\ No newline at end of file
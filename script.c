@@ -0,0 +1,121 @@
+/*
+ * script.c
+ *
+ * Created: 10/17/2026 9:12:31 AM
+ */ 
+#include <avr/io.h>
+#include "open_interface.h"
+#include "script.h"
+#include "calibration.h"
+
+/// Appends bytes to a script being compiled
+/**
+ * Adds a command to the end of the script if it fits
+ * @param *script the script being compiled
+ * @param bytes the command bytes to append
+ * @param length the number of bytes in the command
+ * @return 1 if the command was added, 0 if the script is full
+ */
+static int appendCommand(Script *script, const uint8_t bytes[], int length) {
+	if (script->length + length > SCRIPT_MAX_LENGTH) {
+		return 0;
+	}
+	for (int i = 0; i < length; i++) {
+		script->bytes[script->length++] = bytes[i];
+	}
+	return 1;
+}
+
+/// Appends a drive wheels command to a script being compiled
+/**
+ * @param *script the script being compiled
+ * @param right the right wheel velocity in mm/s
+ * @param left the left wheel velocity in mm/s
+ * @return 1 if the command was added, 0 if the script is full
+ */
+static int appendWheels(Script *script, int16_t right, int16_t left) {
+	uint8_t command[5] = {OI_OPCODE_DRIVE_WHEELS, right >> 8, right & 0xff, left >> 8, left & 0xff};
+	return appendCommand(script, command, 5);
+}
+
+/// Compiles a sequence of motion steps into a Create script
+/**
+ * Each move or rotate step starts the wheels and then waits on the Create's own distance or angle odometry,
+ * so consecutive steps follow each other without stopping. The wheels are stopped before waits and at the end.
+ * @param *script the script to fill
+ * @param steps the motion steps, in order
+ * @param count the number of steps
+ * @param speed the wheel speed in mm/s used for moves and rotations (1-500)
+ * @return the number of bytes in the script, or -1 if the steps do not fit in SCRIPT_MAX_LENGTH bytes
+ */
+int compileScript(Script *script, const ScriptStep steps[], int count, int speed) {
+	script->length = 0;
+	int fits = 1;
+	
+	for (int i = 0; i < count && fits; i++) {
+		int16_t value = steps[i].value;
+		uint8_t wait[3];
+		
+		if (steps[i].type == SCRIPT_MOVE) {
+			int16_t velocity = (value < 0) ? -speed : speed; //wait distance counts down when driving backwards
+			wait[0] = OI_OPCODE_WAIT_DISTANCE;
+			wait[1] = value >> 8;
+			wait[2] = value & 0xff;
+			fits = appendWheels(script, velocity, velocity) && appendCommand(script, wait, 3);
+		}
+		else if (steps[i].type == SCRIPT_ROTATE) {
+			int16_t angle = value;
+			if (value > calibration.rotation) { //stop early to cover the coast after the wheels stop
+				angle = value - calibration.rotation;
+			}
+			else if (value < -calibration.rotation) {
+				angle = value + calibration.rotation;
+			}
+			int16_t velocity = (value < 0) ? -speed : speed;
+			wait[0] = OI_OPCODE_WAIT_ANGLE;
+			wait[1] = angle >> 8;
+			wait[2] = angle & 0xff;
+			fits = appendWheels(script, velocity, -velocity) && appendCommand(script, wait, 3);
+		}
+		else if (steps[i].type == SCRIPT_WAIT) {
+			wait[0] = OI_OPCODE_WAIT_TIME;
+			wait[1] = value;
+			fits = appendWheels(script, 0, 0) && appendCommand(script, wait, 2);
+		}
+		else if (steps[i].type == SCRIPT_EVENT) {
+			wait[0] = OI_OPCODE_WAIT_EVENT;
+			wait[1] = (int8_t) value; //two's complement byte, negative means inverse event
+			fits = appendCommand(script, wait, 2);
+		}
+	}
+	
+	if (!fits || !appendWheels(script, 0, 0)) { //always finish stopped
+		script->length = 0;
+		return -1;
+	}
+	return script->length;
+}
+
+/// Stores a compiled script on the Create
+/**
+ * Replaces any script already stored; only needs to be sent once for repeated playback
+ * @param *script the compiled script
+ */
+void uploadScript(const Script *script) {
+	uint8_t command[2 + SCRIPT_MAX_LENGTH];
+	command[0] = OI_OPCODE_SCRIPT;
+	command[1] = script->length;
+	for (int i = 0; i < script->length; i++) {
+		command[2 + i] = script->bytes[i];
+	}
+	oi_command_tx(command, 2 + script->length);
+}
+
+/// Plays the script stored on the Create
+/**
+ * Returns immediately - the Create drives itself using its internal odometry while the microcontroller keeps working.
+ * The Create ignores other commands until the script finishes, so hazards are not acted on during playback.
+ */
+void playScript() {
+	oi_byte_tx(OI_OPCODE_PLAY_SCRIPT);
+}
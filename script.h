@@ -0,0 +1,36 @@
+/*
+ * script.h
+ *
+ * Created: 10/17/2026 9:12:40 AM
+ */ 
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <inttypes.h>
+
+#define SCRIPT_MAX_LENGTH 100 //largest script the Create can store, in bytes
+
+//script step types
+#define SCRIPT_MOVE 0 //drive straight - value in mm, negative moves backwards
+#define SCRIPT_ROTATE 1 //spin in place - value in degrees, counterclockwise is positive
+#define SCRIPT_WAIT 2 //stop and wait - value in tenths of a second
+#define SCRIPT_EVENT 3 //wait for an OI event - value is the event id, negative waits for the inverse
+
+typedef struct { //one motion step to be compiled into a script
+	uint8_t type; //SCRIPT_MOVE, SCRIPT_ROTATE, SCRIPT_WAIT or SCRIPT_EVENT
+	int16_t value; //distance, angle, time or event depending on type
+} ScriptStep;
+
+typedef struct { //a compiled Create script
+	uint8_t length; //number of bytes used
+	uint8_t bytes[SCRIPT_MAX_LENGTH];
+} Script;
+
+int compileScript(Script *script, const ScriptStep steps[], int count, int speed);
+
+void uploadScript(const Script *script);
+
+void playScript(void);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * segment.c
+ *
+ * Created: 10/17/2026 7:12:18 PM
+ */ 
+
+#include <stdlib.h>
+#include <string.h>
+#include "ping.h" //objectWidth
+#include "segment.h"
+
+// Closes the open object and files it in the pool, or counts it if the pool is full
+static void segmentFinish(ObjectPool *pool) {
+	Object *object;
+	
+	pool->open = 0;
+	if (pool->count == SEGMENT_CAPACITY) {
+		if (pool->overflow < 255) {
+			pool->overflow++;
+		}
+		return;
+	}
+	object = &pool->objects[pool->count++];
+	object->startDegree = pool->first;
+	object->scannedDegrees = pool->last - pool->first + 1;
+	object->degreePosition = (pool->first + pool->last) / 2; //middle of the object
+	object->cmDistance = pool->pingTotal / pool->steps;
+	object->cmWidth = objectWidth(object->cmDistance, object->scannedDegrees); //calculate width using angular diameter formula
+	object->confidence = (100 * pool->agreeing) / pool->steps;
+	object->isValid = 1;
+}
+
+/// Empties a pool for a new scan
+/**
+ * Marks every object invalid, so callers that walk the whole array skip the unused ones
+ * @param pool the pool the scan will fill
+ */
+void segmentBegin(ObjectPool *pool) {
+	memset(pool, 0, sizeof(*pool));
+}
+
+/// Whether the next step needs a ping distance
+/**
+ * Only steps that start or continue an object use their ping distance - an empty direction would hold the ping
+ * sensor for its full 18.5 ms
+ * @param pool the pool being filled
+ * @param irCm the step's IR distance in cm
+ * @return 1 if segmentAdd will use the step's ping distance
+ */
+char segmentNeedsPing(const ObjectPool *pool, int irCm) {
+	return irCm < (pool->open ? SEGMENT_CONTINUE_CM : SEGMENT_START_CM);
+}
+
+/// Segments one scan step
+/**
+ * Steps must come in order of degree. An object starts where the IR sensor sees something within SEGMENT_START_CM,
+ * and goes on while it sees something within SEGMENT_CONTINUE_CM at a ping distance within SEGMENT_JUMP_CM of the
+ * object's mean so far - an object in front of another one is a separate object. A single step where the IR sensor
+ * sees nothing within SEGMENT_CONTINUE_CM is taken as noise: if the next step goes on, the object spans the gap,
+ * though the gap's reading isn't counted. Two such steps in a row, or a ping jump, finish the object, which then
+ * ends at its last step that went on.
+ * @param pool the pool being filled
+ * @param degree servo position of the step
+ * @param irCm IR distance of the step in cm
+ * @param pingCm ping distance of the step in cm, -1 if the step wasn't pinged - only used when segmentNeedsPing asked for it
+ */
+void segmentAdd(ObjectPool *pool, int degree, int irCm, int pingCm) {
+	if (pool->open && !pool->gap && irCm >= SEGMENT_CONTINUE_CM) {
+		pool->gap = 1; //one wild IR reading doesn't split an object, wait for the next step
+		return;
+	}
+	pool->gap = 0;
+	if (pool->open && (irCm >= SEGMENT_CONTINUE_CM || abs(pingCm - (int) (pool->pingTotal / pool->steps)) > SEGMENT_JUMP_CM)) {
+		segmentFinish(pool);
+	}
+	if (!pool->open && irCm < SEGMENT_START_CM) {
+		pool->open = 1;
+		pool->first = degree;
+		pool->steps = 0;
+		pool->agreeing = 0;
+		pool->pingTotal = 0;
+	}
+	if (pool->open) {
+		pool->last = degree;
+		pool->steps++;
+		pool->pingTotal += pingCm;
+		if (abs(irCm - pingCm) <= SEGMENT_AGREE_CM) {
+			pool->agreeing++;
+		}
+	}
+}
+
+/// Finishes a scan
+/**
+ * Files an object still being seen at the end of the scan
+ * @param pool the pool being filled
+ */
+void segmentEnd(ObjectPool *pool) {
+	if (pool->open) {
+		segmentFinish(pool);
+	}
+}
\ No newline at end of file
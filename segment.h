@@ -0,0 +1,49 @@
+/*
+ * segment.h
+ *
+ * Created: 10/17/2026 7:12:40 PM
+ */ 
+
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <stdint.h>
+
+#define SEGMENT_CAPACITY 20 //objects a pool holds, further objects are only counted
+#define SEGMENT_START_CM 85 //IR distance under which something starts an object - the IR sensor is trustworthy up to here
+#define SEGMENT_CONTINUE_CM 150 //IR distance under which an object already started goes on
+#define SEGMENT_JUMP_CM 20 //a ping distance this far from the object's mean so far belongs to a different object
+#define SEGMENT_AGREE_CM 15 //steps whose IR and ping distances are this close count toward an object's confidence
+
+typedef struct { //a struct that holds a scanned object
+	int degreePosition; //the object's position relative to the servo rotation, the middle of the degrees it was seen at
+	int startDegree; //first degree at which the object was seen
+	int cmDistance; //distance from sensor in cm
+	int cmWidth; //object's actual width in cm
+	int scannedDegrees; //number of degrees for which the object was detected
+	int confidence; //percentage of those degrees at which the IR and ping sensors agreed on the distance
+	int isValid;
+} Object;
+
+typedef struct { //objects found by one scan, and the one being segmented
+	Object objects[SEGMENT_CAPACITY];
+	uint8_t count; //objects in the pool
+	uint8_t overflow; //objects found after the pool was full, which were dropped
+	char open; //an object is being seen
+	char gap; //the last step lost the open object, one more and it is finished
+	int first; //degree the open object was first seen at
+	int last; //latest degree it was seen at
+	uint8_t steps; //steps it was seen in
+	uint8_t agreeing; //steps in which the IR and ping sensors agreed on its distance
+	unsigned long pingTotal; //sum of its ping distances
+} ObjectPool;
+
+void segmentBegin(ObjectPool *pool);
+
+char segmentNeedsPing(const ObjectPool *pool, int irCm);
+
+void segmentAdd(ObjectPool *pool, int degree, int irCm, int pingCm);
+
+void segmentEnd(ObjectPool *pool);
+
+#endif /* SEGMENT_H */
\ No newline at end of file
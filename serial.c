@@ -7,6 +7,18 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "util.h"
+#include "serial.h"
+
+// USART0 data register access. The host simulator (sim/) supplies its own versions in its <avr/io.h>.
+#ifndef SERIAL_UDR0_WRITE
+#define SERIAL_UDR0_WRITE(value) (UDR0 = (value))
+#define SERIAL_UDR0_READ()       (UDR0)
+#endif
+
+// Transmit queue for serial_try_put, drained by the USART0 data register empty interrupt
+static volatile uint8_t serialTxBuffer[SERIAL_TX_BUFFER_SIZE];
+static volatile uint8_t serialTxHead = 0; //next free slot, written by serial_try_put
+static volatile uint8_t serialTxTail = 0; //next byte to send, written by the interrupt
 
 /// Initialized the USART protocol
 /**
@@ -31,11 +43,14 @@ void USART_Init( unsigned int ubrr )
  */
 void USART_Transmit( unsigned char data )
 {
+	/* Let queued bytes go first, so they aren't interleaved with this one */
+	while (UCSR0B & (1<<UDRIE))
+	;
 	/* Wait for empty transmit buffer */
 	while ( !( UCSR0A & (1<<UDRE)) )
 	;
 	/* Put data into buffer, sends the data */
-	UDR0 = data;
+	SERIAL_UDR0_WRITE(data);
 }
 
 /// Receives a single character of data using USART
@@ -50,7 +65,7 @@ unsigned char USART_Receive( void )
 	;
 	/* Get and return received data from buffer */
 	wait_ms(1000);
-	return UDR0;
+	return SERIAL_UDR0_READ();
 }
 
 /// Transmit a full string using USART
@@ -72,5 +87,49 @@ void serial_putString(char toPrint[], int length) {
  */
 char serial_getc() {
 	while ((UCSR0A & 0b10000000) == 0);
-	return UDR0;
+	return SERIAL_UDR0_READ();
+}
+
+/// Checks whether a character has been received
+/**
+ * Lets the main loop keep working between keystrokes instead of blocking in serial_getc
+ * @return nonzero if serial_getc will return without waiting
+ */
+char serial_ready() {
+	return (UCSR0A & 0b10000000) != 0;
+}
+
+/// Queues bytes for transmission if they all fit now
+/**
+ * Never waits - the USART0 data register empty interrupt sends the bytes in the background, so a caller in a hurry
+ * (e.g. a scan streaming its readings) isn't held up by the link
+ * @param bytes the bytes to send
+ * @param length number of bytes, at most SERIAL_TX_BUFFER_SIZE - 1
+ * @return 1 if the bytes were queued, 0 if the queue had no room for all of them
+ */
+char serial_try_put(const uint8_t *bytes, uint8_t length) {
+	uint8_t sreg = SREG;
+	
+	cli();
+	if ((uint8_t) (SERIAL_TX_BUFFER_SIZE - 1 - ((serialTxHead - serialTxTail) & (SERIAL_TX_BUFFER_SIZE - 1))) < length) {
+		SREG = sreg;
+		return 0;
+	}
+	for (uint8_t i = 0; i < length; i++) {
+		serialTxBuffer[serialTxHead] = bytes[i];
+		serialTxHead = (serialTxHead + 1) & (SERIAL_TX_BUFFER_SIZE - 1);
+	}
+	UCSR0B |= (1<<UDRIE); //start (or keep) the interrupt draining the queue
+	SREG = sreg;
+	return 1;
+}
+
+// Data register empty interrupt for USART0; sends the next queued byte
+ISR(USART0_UDRE_vect) {
+	if (serialTxHead == serialTxTail) {
+		UCSR0B &= ~(1<<UDRIE); //queue empty, stop until more is queued
+		return;
+	}
+	SERIAL_UDR0_WRITE(serialTxBuffer[serialTxTail]);
+	serialTxTail = (serialTxTail + 1) & (SERIAL_TX_BUFFER_SIZE - 1);
 }
\ No newline at end of file
@@ -5,6 +5,10 @@
  *  Author: robideau
  */ 
 
+#include <stdint.h>
+
+#define SERIAL_TX_BUFFER_SIZE 128 //bytes serial_try_put can have waiting, a power of two
+
 void USART_Init( unsigned int ubrr );
 
 void USART_Transmit( unsigned char data );
@@ -13,4 +17,8 @@ unsigned char USART_Receive( void );
 
 void serial_putString(char toPrint[], int length);
 
-char serial_getc(void);
\ No newline at end of file
+char serial_getc(void);
+
+char serial_ready(void);
+
+char serial_try_put(const uint8_t *bytes, uint8_t length);
\ No newline at end of file
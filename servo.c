@@ -7,10 +7,15 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "util.h"
+#include "calibration.h"
+
+#define SERVO_MS_PER_DEGREE 3 //servo speed, about 0.19 s per 60 degrees - change as necessary
+#define SERVO_SETTLE_MS 2 //time for the servo to stop oscillating once it arrives
 
 unsigned int pulse_width;
 unsigned pulse_interval = 128;
 unsigned mid_point = 64;
+static unsigned servoDegree = 90; //where the servo was last sent
 
 /// Initializes timer 3 for use with the servo
 /**
@@ -27,13 +32,27 @@ void timer3_init() {
 	DDRE |= _BV(4); //set port E pin 4 as output
 }
 
+/// Sends the servo to a position without waiting for it
+/**
+ * Converts a degree value to a pulse width, which is sent to the servo
+ * @param degree the position to rotate the servo to
+ * @return milliseconds until the servo has arrived and settled
+ */
+unsigned servo_set(unsigned degree) {
+	unsigned travel = (degree > servoDegree) ? degree - servoDegree : servoDegree - degree;
+	
+	pulse_width = (((long) calibration.servoSpan*((int) degree+calibration.servoTrim))/180) + calibration.servoBase; //calculate pulse width
+	OCR3B = pulse_width;
+	servoDegree = degree;
+	return travel * SERVO_MS_PER_DEGREE + SERVO_SETTLE_MS;
+}
+
 /// Rotates the servo by a given number of degrees
 /**
  * Converts a degree value to a pulse width, which is sent to the servo
  * @param degree the number of degrees to rotate the servo
  */
 void move_servo(unsigned degree) {
-	pulse_width = (((108*(degree+10))/180) + 29); //calculate pulse width
-	OCR3B = pulse_width;
+	servo_set(degree);
 	wait_ms(5); //wait for servo to move - change as necessary
 }
\ No newline at end of file
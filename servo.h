@@ -7,4 +7,6 @@
 
 void timer3_init(void);
 
+unsigned servo_set(unsigned degree);
+
 void move_servo(unsigned degree);
\ No newline at end of file
@@ -0,0 +1,21 @@
+/**
+ * avr/eeprom.h: host stand-in; EEPROM is ordinary memory on the host and starts out blank every run
+ */
+
+#ifndef SIM_AVR_EEPROM_H
+#define SIM_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <string.h>
+
+#define EEMEM
+
+static inline void eeprom_read_block(void *destination, const void *source, size_t size) {
+	memcpy(destination, source, size);
+}
+
+static inline void eeprom_update_block(const void *source, void *destination, size_t size) {
+	memcpy(destination, source, size);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+/**
+ * avr/interrupt.h: host stand-in; interrupt handlers become plain functions called by the simulator
+ */
+
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define ISR(vector) void vector(void)
+
+static inline void sei(void) {
+	sim_sreg |= 0x80;
+}
+
+static inline void cli(void) {
+	sim_sreg &= ~0x80;
+}
+
+#endif
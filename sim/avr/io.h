@@ -0,0 +1,101 @@
+/**
+ * avr/io.h: host stand-in for the ATmega128 registers used by the Rover firmware
+ *
+ * Plain registers are ordinary globals. Registers the firmware polls in busy loops
+ * (UCSR0A, UCSR0B, UCSR1A, UCSR1B, SREG, ADCSRA) go through sim_io(), which advances simulated time
+ * and runs any pending interrupt handlers before returning the register. TCNT1 is
+ * computed from simulated time and can only be read.
+ * The USART1 data register is reached through OI_UDR1_READ/OI_UDR1_WRITE so the
+ * simulated Create sees every byte the firmware sends, and the USART0 one through
+ * SERIAL_UDR0_READ/SERIAL_UDR0_WRITE so the terminal does.
+ */
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+/// Advance simulated time by one register access and return the register
+volatile uint8_t *sim_io(volatile uint8_t *reg);
+
+/// Bytes between the firmware and the simulated Create
+uint8_t sim_uart1_read(void);
+void sim_uart1_write(uint8_t value);
+
+#define OI_UDR1_WRITE(value) sim_uart1_write(value)
+#define OI_UDR1_READ()       sim_uart1_read()
+
+/// Bytes between the firmware and the terminal
+uint8_t sim_uart0_read(void);
+void sim_uart0_write(uint8_t value);
+
+#define SERIAL_UDR0_WRITE(value) sim_uart0_write(value)
+#define SERIAL_UDR0_READ()       sim_uart0_read()
+
+extern volatile uint8_t sim_ucsr0a, sim_ucsr0b, sim_ucsr1a, sim_ucsr1b, sim_sreg, sim_adcsra;
+#define UCSR0A (*sim_io(&sim_ucsr0a))
+#define UCSR0B (*sim_io(&sim_ucsr0b))
+#define UCSR1A (*sim_io(&sim_ucsr1a))
+#define UCSR1B (*sim_io(&sim_ucsr1b))
+#define SREG   (*sim_io(&sim_sreg))
+#define ADCSRA (*sim_io(&sim_adcsra))
+
+/// Timer 1 count, running at 250 kHz (16 MHz with the 64 prescaler timer1_init selects)
+uint16_t sim_tcnt1(void);
+#define TCNT1 sim_tcnt1()
+
+extern volatile uint8_t UDR1, UBRR1L, UBRR1H, UCSR1C;
+extern volatile uint8_t UBRR0L, UBRR0H, UCSR0C;
+extern volatile uint8_t DDRA, DDRB, DDRC, DDRD, DDRE;
+extern volatile uint8_t PORTA, PORTB, PORTC, PORTD, PORTE;
+extern volatile uint8_t PINA, PINB, PINC, PIND, PINE;
+extern volatile uint8_t TCCR0, OCR0, TCNT0, TCCR1A, TCCR1B, TCCR1C, TCCR2, OCR2, TCNT2;
+extern volatile uint8_t TCCR3A, TCCR3B, TCCR3C, TIMSK, TIFR, ETIMSK, ETIFR;
+extern volatile uint16_t ICR1, OCR3A, OCR3B, TCNT3;
+extern volatile uint8_t ADMUX, SFIOR;
+extern volatile uint16_t ADC;
+
+// USART
+#define RXC    7
+#define TXC    6
+#define UDRE   5
+#define FE     4
+#define DOR    3
+#define U2X    1
+#define RXCIE  7
+#define TXCIE  6
+#define UDRIE  5
+#define RXEN   4
+#define TXEN   3
+#define USBS   3
+#define UCSZ0  1
+#define UCSZ10 1
+
+// ADC
+#define REFS1 7
+#define REFS0 6
+#define ADEN  7
+#define ADSC  6
+#define ADFR  5
+#define ADIF  4
+#define ADIE  3
+#define ADPS0 0
+
+// Timers
+#define ICES1  6
+#define ICF1   5
+#define TICIE1 5
+#define TOIE1  2
+#define TOV1   2
+#define OCIE0  1
+#define OCF0   1
+#define OCIE2  7
+#define OCF2   7
+#define WGM01  3
+#define CS00   0
+#define CS01   1
+#define CS02   2
+
+#endif
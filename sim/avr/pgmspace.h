@@ -0,0 +1,15 @@
+/**
+ * avr/pgmspace.h: host stand-in; program memory is ordinary memory on the host
+ */
+
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(address)  (*(const uint8_t *) (address))
+#define pgm_read_word(address)  (*(const uint16_t *) (address))
+#define pgm_read_dword(address) (*(const uint32_t *) (address))
+
+#endif
@@ -0,0 +1,610 @@
+/**
+ * create_sim.c: host-side model of an iRobot Create speaking the Open Interface
+ *
+ * Opcodes and packet ids follow open_interface.h and the Create Open Interface v2 manual.
+ *
+ * @date 10/17/2026
+ */
+
+#include <math.h>
+#include <string.h>
+#include "../open_interface.h"
+#include "create_sim.h"
+
+#define SIM_PI 3.14159265358979323846
+#define SIM_STREAM_PERIOD 0.015 // seconds between stream frames
+#define SIM_PHYSICS_STEP 0.001  // seconds per physics update
+#define SIM_OUT_SIZE 1024       // bytes waiting to go to the microcontroller
+#define SIM_SCRIPT_SIZE 100
+#define SIM_STOP_DECELERATION 700.0 // mm/s^2 of a wheel told to stop; from 200 mm/s it coasts the 13 degrees measured on robot 4
+
+// Surfaces seen by the cliff sensors
+#define SIM_FLOOR 0
+#define SIM_WHITE 1
+#define SIM_BLACK 2
+#define SIM_CLIFF 3
+
+typedef struct {
+	double x, y, r;
+} sim_disc_t;
+
+typedef struct {
+	double x0, y0, x1, y1;
+} sim_rect_t;
+
+// The field: posts trip the bumpers, holes trip the cliff sensors, the black circle is the goal
+static sim_disc_t sim_posts[] = {{700, 250, 40}, {-450, 800, 60}, {300, -900, 35}};
+static double sim_post_vx = 0, sim_post_vy = 0; // velocity of the first post, mm/s
+static const sim_rect_t sim_holes[] = {{-1400, -1400, -1000, -1100}};
+static const sim_disc_t sim_black[] = {{1000, -1000, 150}};
+
+// Cliff sensor mounting: angle from the heading (radians) and distance from the center (mm).
+// Order matches packets 28-31: left, front left, front right, right.
+static const double sim_cliff_angle[4] = {1.22, 0.35, -0.35, -1.22};
+#define SIM_CLIFF_RADIUS 150.0
+
+// Cliff signal per surface and sensor; each sensor has its own gain, like the real robot
+static const uint16_t sim_cliff_signal[4][4] = {
+	{300, 60, 500, 600},    // floor
+	{900, 200, 1400, 1600}, // white tape
+	{30, 10, 60, 80},       // black circle
+	{2, 1, 3, 3},           // cliff
+};
+
+static const unsigned long sim_baud_codes[] = {300, 600, 1200, 2400, 4800, 9600, 14400, 19200, 28800, 38400, 57600, 115200};
+static uint16_t sim_baud_refused = 0; // baud codes the Create ignores the baud command for, one bit per code
+static uint16_t sim_baud_garbled = 0; // baud codes at which every fourth byte the Create sends is garbled
+static int sim_pattern = 0; // send a fixed pattern for every sensor packet instead of the robot's state
+
+typedef struct {
+	create_sim_state_t state;
+	double left_scale;
+
+	// commanded wheel speeds, mm/s
+	int16_t velocity, radius, right_velocity, left_velocity;
+	// speeds the wheels turn at, mm/s; they follow the commands at once, except that a stop coasts
+	double right_speed, left_speed;
+
+	// odometry not yet reported (packets 19 and 20)
+	double distance;
+	double angle;
+
+	uint8_t baud_code;
+	uint8_t song_number;
+
+	// command being received
+	uint8_t command[2 + SIM_SCRIPT_SIZE];
+	uint8_t command_length;
+
+	// stream
+	uint8_t stream_packets[64];
+	uint8_t stream_count;
+	uint8_t stream_on;
+	double stream_timer;
+
+	// script
+	uint8_t script[SIM_SCRIPT_SIZE];
+	uint8_t script_length;
+	uint8_t script_pc;
+	uint8_t wait_type; // 0 none, or the wait opcode being executed
+	double wait_target;
+	double wait_progress;
+	int8_t wait_event;
+
+	double physics_timer;
+
+	// bytes to the microcontroller
+	uint8_t out[SIM_OUT_SIZE];
+	uint16_t out_head, out_tail;
+} sim_t;
+
+static sim_t sim;
+
+static void sim_execute(const uint8_t *command, uint8_t length);
+
+static void sim_out(uint8_t value) {
+	uint16_t next = (sim.out_head + 1) % SIM_OUT_SIZE;
+	if (next == sim.out_tail) {
+		return; // microcontroller is not reading; drop like the real UART would
+	}
+	sim.out[sim.out_head] = value;
+	sim.out_head = next;
+}
+
+void create_sim_init(void) {
+	memset(&sim, 0, sizeof(sim));
+	sim.left_scale = 1.0;
+	sim.baud_code = 10; // 57600 after power on
+}
+
+void create_sim_place(double x, double y, double heading) {
+	sim.state.x = x;
+	sim.state.y = y;
+	sim.state.heading = heading;
+}
+
+void create_sim_set_wheel_bias(double left_scale) {
+	sim.left_scale = left_scale;
+}
+
+void create_sim_move_post(double vx, double vy) {
+	sim_post_vx = vx;
+	sim_post_vy = vy;
+}
+
+// Bit for a baud rate in the refused and garbled masks, 0 if the Create has no such rate
+static uint16_t sim_baud_bit(unsigned long baud) {
+	unsigned code;
+
+	for (code = 0; code < sizeof(sim_baud_codes) / sizeof(sim_baud_codes[0]); code++) {
+		if (sim_baud_codes[code] == baud) {
+			return 1 << code;
+		}
+	}
+	return 0;
+}
+
+void create_sim_refuse_baud(unsigned long baud, int refuse) {
+	sim_baud_refused = refuse ? (sim_baud_refused | sim_baud_bit(baud)) : (sim_baud_refused & ~sim_baud_bit(baud));
+}
+
+void create_sim_sensor_pattern(int on) {
+	sim_pattern = on;
+}
+
+void create_sim_garble_baud(unsigned long baud, int garble) {
+	sim_baud_garbled = garble ? (sim_baud_garbled | sim_baud_bit(baud)) : (sim_baud_garbled & ~sim_baud_bit(baud));
+}
+
+unsigned long create_sim_baud(void) {
+	return sim_baud_codes[sim.baud_code];
+}
+
+const create_sim_state_t *create_sim_state(void) {
+	return &sim.state;
+}
+
+int create_sim_tx(uint8_t *value) {
+	if (sim.out_head == sim.out_tail) {
+		return 0;
+	}
+	*value = sim.out[sim.out_tail];
+	sim.out_tail = (sim.out_tail + 1) % SIM_OUT_SIZE;
+	sim.state.bytes_out++;
+	if ((sim_baud_garbled & (1 << sim.baud_code)) && sim.state.bytes_out % 4 == 0) {
+		*value ^= 0x5A;
+	}
+	return 1;
+}
+
+// ---------------------------------------------------------------- world
+
+static int sim_in_disc(const sim_disc_t *disc, double x, double y, double margin) {
+	double dx = x - disc->x;
+	double dy = y - disc->y;
+	return dx * dx + dy * dy < (disc->r + margin) * (disc->r + margin);
+}
+
+static int sim_surface(double x, double y) {
+	unsigned i;
+	double edge = CREATE_SIM_FIELD / 2;
+
+	for (i = 0; i < sizeof(sim_holes) / sizeof(sim_holes[0]); i++) {
+		if (x > sim_holes[i].x0 && x < sim_holes[i].x1 && y > sim_holes[i].y0 && y < sim_holes[i].y1) {
+			return SIM_CLIFF;
+		}
+	}
+	if (fabs(x) > edge || fabs(y) > edge) {
+		return SIM_CLIFF; // off the field
+	}
+	for (i = 0; i < sizeof(sim_black) / sizeof(sim_black[0]); i++) {
+		if (sim_in_disc(&sim_black[i], x, y, 0)) {
+			return SIM_BLACK;
+		}
+	}
+	if (fabs(x) > edge - CREATE_SIM_TAPE || fabs(y) > edge - CREATE_SIM_TAPE) {
+		return SIM_WHITE;
+	}
+	return SIM_FLOOR;
+}
+
+double create_sim_range(double bearing) {
+	double a = sim.state.heading + bearing;
+	double nearest = -1;
+	unsigned i;
+
+	for (i = 0; i < sizeof(sim_posts) / sizeof(sim_posts[0]); i++) {
+		double px = sim_posts[i].x - sim.state.x;
+		double py = sim_posts[i].y - sim.state.y;
+		double along = px * cos(a) + py * sin(a);
+		double miss = px * px + py * py - along * along; // squared distance of the post's center from the ray
+		double r2 = sim_posts[i].r * sim_posts[i].r;
+		if (along <= 0 || miss > r2) {
+			continue;
+		}
+		double hit = along - sqrt(r2 - miss);
+		if (hit > 0 && (nearest < 0 || hit < nearest)) {
+			nearest = hit;
+		}
+	}
+	return nearest;
+}
+
+static int sim_cliff_surface(int sensor) {
+	double a = sim.state.heading + sim_cliff_angle[sensor];
+	return sim_surface(sim.state.x + SIM_CLIFF_RADIUS * cos(a), sim.state.y + SIM_CLIFF_RADIUS * sin(a));
+}
+
+// Bumper bits for packet 7 at a position: bit 0 right, bit 1 left
+static uint8_t sim_bumpers_at(double x, double y, double heading) {
+	uint8_t bumps = 0;
+	unsigned i;
+
+	for (i = 0; i < sizeof(sim_posts) / sizeof(sim_posts[0]); i++) {
+		if (!sim_in_disc(&sim_posts[i], x, y, CREATE_SIM_RADIUS)) {
+			continue;
+		}
+		double bearing = atan2(sim_posts[i].y - y, sim_posts[i].x - x) - heading;
+		bearing = atan2(sin(bearing), cos(bearing));
+		if (fabs(bearing) > SIM_PI / 2) {
+			continue; // the bumper only covers the front half
+		}
+		if (bearing > -0.2) {
+			bumps |= 0x02;
+		}
+		if (bearing < 0.2) {
+			bumps |= 0x01;
+		}
+	}
+	return bumps;
+}
+
+// ---------------------------------------------------------------- physics
+
+// A wheel told to stop slows down over a few centimetres instead of stopping dead
+static double sim_wheel_coast(double speed, int16_t commanded, double dt) {
+	double slowed = fabs(speed) - SIM_STOP_DECELERATION * dt;
+
+	if (commanded != 0) {
+		return commanded;
+	}
+	return (slowed > 0) ? copysign(slowed, speed) : 0;
+}
+
+static void sim_wheel_speeds(double dt, double *right, double *left) {
+	sim.right_speed = sim_wheel_coast(sim.right_speed, sim.right_velocity, dt);
+	sim.left_speed = sim_wheel_coast(sim.left_speed, sim.left_velocity, dt);
+	*right = sim.right_speed;
+	*left = sim.left_speed * sim.left_scale;
+}
+
+static void sim_physics(double dt) {
+	double right, left;
+	sim_wheel_speeds(dt, &right, &left);
+
+	sim_posts[0].x += sim_post_vx * dt;
+	sim_posts[0].y += sim_post_vy * dt;
+
+	double v = (right + left) / 2;
+	double w = (right - left) / CREATE_SIM_WHEEL_BASE;
+	double heading = sim.state.heading + w * dt;
+	double x = sim.state.x + v * dt * cos(heading);
+	double y = sim.state.y + v * dt * sin(heading);
+
+	// a pressed bumper stops the base from pushing further into the obstacle
+	if (v > 0 && sim_bumpers_at(x, y, heading) && sim_bumpers_at(sim.state.x, sim.state.y, sim.state.heading)) {
+		x = sim.state.x;
+		y = sim.state.y;
+		v = 0;
+	}
+
+	double moved = hypot(x - sim.state.x, y - sim.state.y);
+	sim.state.travelled += moved;
+	sim.distance += (v < 0) ? -moved : moved;
+	sim.angle += w * dt * 180.0 / SIM_PI;
+	sim.state.x = x;
+	sim.state.y = y;
+	sim.state.heading = atan2(sin(heading), cos(heading));
+
+	if (sim.wait_type == OI_OPCODE_WAIT_TIME) {
+		sim.wait_progress += dt;
+	}
+	else if (sim.wait_type == OI_OPCODE_WAIT_DISTANCE) {
+		sim.wait_progress += (v < 0) ? -moved : moved;
+	}
+	else if (sim.wait_type == OI_OPCODE_WAIT_ANGLE) {
+		sim.wait_progress += w * dt * 180.0 / SIM_PI;
+	}
+}
+
+// ---------------------------------------------------------------- sensors
+
+static int16_t sim_take(double *accumulated) {
+	int16_t whole = (int16_t) *accumulated; // report whole units, keep the remainder for the next report
+	*accumulated -= whole;
+	return whole;
+}
+
+// Writes the data bytes of one packet and returns how many were written
+static uint8_t sim_packet(uint8_t id, uint8_t *out) {
+	uint16_t word = 0;
+	uint8_t wide = 1;
+	uint8_t byte = 0;
+
+	switch (id) {
+	case 7: byte = sim_bumpers_at(sim.state.x, sim.state.y, sim.state.heading); wide = 0; break;
+	case 9: case 10: case 11: case 12:
+		byte = sim_cliff_surface(id - 9) == SIM_CLIFF;
+		wide = 0;
+		break;
+	case 17: byte = 255; wide = 0; break; // no IR character
+	case 19: word = sim_take(&sim.distance); break;
+	case 20: word = sim_take(&sim.angle); break;
+	case 21: byte = 0; wide = 0; break;
+	case 22: word = 15000; break;
+	case 23: word = (uint16_t) -500; break;
+	case 24: byte = 25; wide = 0; break;
+	case 25: word = 2500; break;
+	case 26: word = 2700; break;
+	case 27: word = 0; break;
+	case 28: case 29: case 30: case 31:
+		word = sim_cliff_signal[sim_cliff_surface(id - 28)][id - 28];
+		break;
+	case 33: word = 0; break;
+	case 35: byte = sim.state.mode; wide = 0; break;
+	case 36: byte = sim.song_number; wide = 0; break;
+	case 38: byte = sim.stream_count; wide = 0; break;
+	case 39: word = sim.velocity; break;
+	case 40: word = sim.radius; break;
+	case 41: word = sim.right_velocity; break;
+	case 42: word = sim.left_velocity; break;
+	default: wide = 0; break; // remaining single-byte packets read as 0
+	}
+	if (sim_pattern) {
+		byte = 0x80 | id;
+		word = ((0x80 | id) << 8) | id;
+	}
+	if (wide) {
+		out[0] = word >> 8;
+		out[1] = word & 0xff;
+		return 2;
+	}
+	out[0] = byte;
+	return 1;
+}
+
+// Sends the data for a packet id or group id
+static void sim_send_packet(uint8_t id) {
+	static const uint8_t groups[7][2] = {{7, 26}, {7, 16}, {17, 20}, {21, 26}, {27, 34}, {35, 42}, {7, 42}};
+	uint8_t data[2];
+	uint8_t first = id;
+	uint8_t last = id;
+	uint8_t i;
+
+	if (id <= 6) {
+		first = groups[id][0];
+		last = groups[id][1];
+	}
+	for (i = first; i <= last; i++) {
+		uint8_t n = sim_packet(i, data);
+		sim_out(data[0]);
+		if (n == 2) {
+			sim_out(data[1]);
+		}
+	}
+}
+
+static void sim_send_stream_frame(void) {
+	uint8_t frame[2 + 3 * 64];
+	uint8_t length = 0;
+	uint8_t sum = 0;
+	uint8_t i;
+
+	for (i = 0; i < sim.stream_count; i++) {
+		frame[2 + length++] = sim.stream_packets[i];
+		length += sim_packet(sim.stream_packets[i], &frame[2 + length]);
+	}
+	frame[0] = OI_STREAM_HEADER;
+	frame[1] = length;
+	for (i = 0; i < length + 2; i++) {
+		sim_out(frame[i]);
+		sum += frame[i];
+	}
+	sim_out((uint8_t) -sum);
+	sim.state.frames++;
+	sim.state.frame_length = length;
+}
+
+// ---------------------------------------------------------------- commands
+
+// Total length of the command in buf, or 0 if more bytes are needed to know it
+static uint8_t sim_command_length(const uint8_t *buf, uint8_t have) {
+	switch (buf[0]) {
+	case OI_OPCODE_START: case OI_OPCODE_CONTROL: case OI_OPCODE_SAFE: case OI_OPCODE_FULL:
+	case OI_OPCODE_POWER: case OI_OPCODE_SPOT: case OI_OPCODE_CLEAN: case OI_OPCODE_FORCEDOCK:
+	case OI_OPCODE_PLAY_SCRIPT: case OI_OPCODE_SHOW_SCRIPT:
+		return 1;
+	case OI_OPCODE_BAUD: case OI_OPCODE_MAX: case OI_OPCODE_MOTORS: case OI_OPCODE_PLAY:
+	case OI_OPCODE_SENSORS: case OI_OPCODE_OUTPUTS: case OI_OPCODE_DO_STREAM: case OI_OPCODE_SEND_IR_CHAR:
+	case OI_OPCODE_WAIT_TIME: case OI_OPCODE_WAIT_EVENT:
+		return 2;
+	case OI_OPCODE_WAIT_DISTANCE: case OI_OPCODE_WAIT_ANGLE:
+		return 3;
+	case OI_OPCODE_LEDS: case OI_OPCODE_PWM_MOTORS:
+		return 4;
+	case OI_OPCODE_DRIVE: case OI_OPCODE_DRIVE_WHEELS: case OI_OPCODE_DRIVE_PWM:
+		return 5;
+	case OI_OPCODE_SONG:
+		return (have < 3) ? 0 : 3 + 2 * buf[2];
+	case OI_OPCODE_STREAM: case OI_OPCODE_QUERY_LIST: case OI_OPCODE_SCRIPT:
+		return (have < 2) ? 0 : 2 + buf[1];
+	}
+	return 1; // unknown opcode, ignored
+}
+
+static void sim_drive(int16_t velocity, int16_t radius) {
+	sim.velocity = velocity;
+	sim.radius = radius;
+	if (radius == (int16_t) 0x8000 || radius == 0x7FFF) { // straight
+		sim.right_velocity = sim.left_velocity = velocity;
+	}
+	else if (radius == -1) { // spin clockwise
+		sim.right_velocity = -velocity;
+		sim.left_velocity = velocity;
+	}
+	else if (radius == 1) { // spin counterclockwise
+		sim.right_velocity = velocity;
+		sim.left_velocity = -velocity;
+	}
+	else {
+		sim.right_velocity = velocity * (radius + CREATE_SIM_WHEEL_BASE / 2) / radius;
+		sim.left_velocity = velocity * (radius - CREATE_SIM_WHEEL_BASE / 2) / radius;
+	}
+}
+
+// Event ids for the wait event opcode that the model can detect
+static int sim_event(int8_t event) {
+	uint8_t id = (event < 0) ? -event : event;
+	int happened = 0;
+	uint8_t bumps = sim_bumpers_at(sim.state.x, sim.state.y, sim.state.heading);
+
+	switch (id) {
+	case 5: happened = bumps != 0; break; // bump
+	case 6: happened = (bumps & 0x02) != 0; break; // left bump
+	case 7: happened = (bumps & 0x01) != 0; break; // right bump
+	case 10: // any cliff
+		happened = sim_cliff_surface(0) == SIM_CLIFF || sim_cliff_surface(1) == SIM_CLIFF ||
+		           sim_cliff_surface(2) == SIM_CLIFF || sim_cliff_surface(3) == SIM_CLIFF;
+		break;
+	}
+	return (event < 0) ? !happened : happened;
+}
+
+static void sim_execute(const uint8_t *c, uint8_t length) {
+	uint8_t i;
+
+	if (sim.state.mode == 0 && c[0] != OI_OPCODE_START) {
+		return; // everything but start is ignored until the OI is started
+	}
+	switch (c[0]) {
+	case OI_OPCODE_START: sim.state.mode = 1; break;
+	case OI_OPCODE_BAUD:
+		if (c[1] < sizeof(sim_baud_codes) / sizeof(sim_baud_codes[0]) && !(sim_baud_refused & (1 << c[1]))) {
+			sim.baud_code = c[1];
+		}
+		break;
+	case OI_OPCODE_CONTROL: case OI_OPCODE_SAFE: sim.state.mode = 2; break;
+	case OI_OPCODE_FULL: sim.state.mode = 3; break;
+	case OI_OPCODE_DRIVE:
+		sim_drive((c[1] << 8) | c[2], (c[3] << 8) | c[4]);
+		break;
+	case OI_OPCODE_DRIVE_WHEELS:
+		sim.right_velocity = (c[1] << 8) | c[2];
+		sim.left_velocity = (c[3] << 8) | c[4];
+		sim.velocity = (sim.right_velocity + sim.left_velocity) / 2;
+		break;
+	case OI_OPCODE_PLAY: sim.song_number = c[1]; break;
+	case OI_OPCODE_SENSORS: sim_send_packet(c[1]); break;
+	case OI_OPCODE_QUERY_LIST:
+		for (i = 0; i < c[1]; i++) {
+			sim_send_packet(c[2 + i]);
+		}
+		break;
+	case OI_OPCODE_STREAM:
+		sim.stream_count = MIN(c[1], sizeof(sim.stream_packets));
+		memcpy(sim.stream_packets, &c[2], sim.stream_count);
+		sim.stream_on = 1;
+		break;
+	case OI_OPCODE_DO_STREAM: sim.stream_on = c[1]; break;
+	case OI_OPCODE_SCRIPT:
+		sim.script_length = MIN(c[1], SIM_SCRIPT_SIZE);
+		memcpy(sim.script, &c[2], sim.script_length);
+		break;
+	case OI_OPCODE_PLAY_SCRIPT:
+		sim.script_pc = 0;
+		sim.state.script_running = 1;
+		break;
+	case OI_OPCODE_WAIT_TIME:
+		sim.wait_type = c[0];
+		sim.wait_target = c[1] / 10.0;
+		sim.wait_progress = 0;
+		break;
+	case OI_OPCODE_WAIT_DISTANCE: case OI_OPCODE_WAIT_ANGLE:
+		sim.wait_type = c[0];
+		sim.wait_target = (int16_t) ((c[1] << 8) | c[2]);
+		sim.wait_progress = 0;
+		break;
+	case OI_OPCODE_WAIT_EVENT:
+		sim.wait_type = c[0];
+		sim.wait_event = (int8_t) c[1];
+		break;
+	}
+}
+
+void create_sim_rx(uint8_t value) {
+	sim.state.bytes_in++;
+	if (sim.state.script_running) {
+		return; // the Create does not respond to serial commands while a script plays
+	}
+	if (sim.command_length >= sizeof(sim.command)) {
+		sim.command_length = 0;
+	}
+	sim.command[sim.command_length++] = value;
+	uint8_t needed = sim_command_length(sim.command, sim.command_length);
+	if (needed != 0 && sim.command_length >= needed) {
+		sim_execute(sim.command, sim.command_length);
+		sim.command_length = 0;
+	}
+}
+
+// Whether the current wait command has finished
+static int sim_wait_done(void) {
+	switch (sim.wait_type) {
+	case OI_OPCODE_WAIT_TIME: return sim.wait_progress >= sim.wait_target;
+	case OI_OPCODE_WAIT_EVENT: return sim_event(sim.wait_event);
+	case OI_OPCODE_WAIT_DISTANCE: case OI_OPCODE_WAIT_ANGLE:
+		return (sim.wait_target >= 0) ? sim.wait_progress >= sim.wait_target : sim.wait_progress <= sim.wait_target;
+	}
+	return 1;
+}
+
+// Runs script commands until a wait is pending or the script ends
+static void sim_run_script(void) {
+	while (sim.state.script_running) {
+		if (sim.wait_type) {
+			if (!sim_wait_done()) {
+				return;
+			}
+			sim.wait_type = 0;
+		}
+		if (sim.script_pc >= sim.script_length) {
+			sim.state.script_running = 0;
+			return;
+		}
+		uint8_t *c = &sim.script[sim.script_pc];
+		uint8_t length = sim_command_length(c, sim.script_length - sim.script_pc);
+		if (length == 0 || sim.script_pc + length > sim.script_length) {
+			sim.state.script_running = 0;
+			return;
+		}
+		sim.script_pc += length;
+		sim_execute(c, length);
+	}
+}
+
+void create_sim_advance(double seconds) {
+	sim.physics_timer += seconds;
+	while (sim.physics_timer >= SIM_PHYSICS_STEP) {
+		sim.physics_timer -= SIM_PHYSICS_STEP;
+		sim_physics(SIM_PHYSICS_STEP);
+		sim_run_script();
+
+		if (sim.stream_on && sim.stream_count) {
+			sim.stream_timer += SIM_PHYSICS_STEP;
+			if (sim.stream_timer >= SIM_STREAM_PERIOD) {
+				sim.stream_timer -= SIM_STREAM_PERIOD;
+				sim_send_stream_frame();
+			}
+		}
+	}
+}
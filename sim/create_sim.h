@@ -0,0 +1,74 @@
+/**
+ * create_sim.h: host-side model of an iRobot Create speaking the Open Interface
+ *
+ * The model accepts OI command bytes, answers sensor queries and streams, plays scripts,
+ * and moves a differential-drive base around a field with obstacles, cliffs, white tape
+ * and a black circle.
+ *
+ * @date 10/17/2026
+ */
+
+#ifndef CREATE_SIM_H
+#define CREATE_SIM_H
+
+#include <stdint.h>
+
+#define CREATE_SIM_WHEEL_BASE 258.0 // mm between the wheels
+#define CREATE_SIM_RADIUS 170.0     // mm, body radius used for collisions
+#define CREATE_SIM_FIELD 3000.0     // mm, side of the square field centered on the origin
+#define CREATE_SIM_TAPE 50.0        // mm, width of the white tape along the field edge
+
+/// True robot state and counters, for reports and benchmarks
+typedef struct {
+	double x;       // mm
+	double y;       // mm
+	double heading; // radians, counterclockwise from +x
+	double travelled; // mm driven in total
+	uint32_t bytes_in;  // bytes received from the microcontroller
+	uint32_t bytes_out; // bytes sent to the microcontroller
+	uint32_t frames;    // stream frames sent
+	uint8_t frame_length; // payload bytes of the last stream frame
+	uint8_t mode;       // OI mode: 0 off, 1 passive, 2 safe, 3 full
+	uint8_t script_running;
+} create_sim_state_t;
+
+/// Reset the Create to power-on state at the origin, facing +x
+void create_sim_init(void);
+
+/// Place the robot in the field
+void create_sim_place(double x, double y, double heading);
+
+/// Distance in mm from the robot's center to the nearest post along a bearing (radians from the heading), -1 if none
+double create_sim_range(double bearing);
+
+/// Scale the left wheel's actual speed, e.g. 1.02 to make the robot drift right
+void create_sim_set_wheel_bias(double left_scale);
+
+/// Move the first post at a constant velocity in mm/s, for following moving objects
+void create_sim_move_post(double vx, double vy);
+
+/// Make the Create ignore the baud command for a rate (refuse 1) or accept it again (refuse 0)
+void create_sim_refuse_baud(unsigned long baud, int refuse);
+
+/// Garble every fourth byte the Create sends at a rate (garble 1), like a marginal link, or stop (garble 0)
+void create_sim_garble_baud(unsigned long baud, int garble);
+
+/// Answer every sensor packet with a fixed pattern (on 1): 0x80 | id, followed by id for two-byte packets
+void create_sim_sensor_pattern(int on);
+
+/// Feed one byte sent by the microcontroller to the Create
+void create_sim_rx(uint8_t value);
+
+/// Take the next byte the Create wants to send; returns 0 if there is none
+int create_sim_tx(uint8_t *value);
+
+/// Advance physics, script waits and the sensor stream
+void create_sim_advance(double seconds);
+
+/// Baud rate the Create is currently using
+unsigned long create_sim_baud(void);
+
+/// Current true state
+const create_sim_state_t *create_sim_state(void);
+
+#endif
@@ -0,0 +1,483 @@
+/**
+ * sim_avr.c: host stand-in for the ATmega128 board around the firmware
+ *
+ * Holds the register globals, advances simulated time on every polled register access,
+ * runs the USART, timer and ADC interrupt handlers, carries bytes between USART1 and the
+ * simulated Create at the configured baud rates, answers the ping sensor's trigger pulse
+ * with an echo from the nearest post in the servo's direction, converts the IR sensor's
+ * view of the same post on the ADC (single or free running, with its interrupt), counts
+ * timers 0 and 2 for util.c, and connects USART0 to the terminal for serial.c.
+ *
+ * USART0 sends at the rate in UBRR0. Every byte it sends goes to the capture file, the
+ * text to stdout, without carriage returns, NULs or telemetry frames. Bytes typed on stdin
+ * arrive one at a time at the same rate; once stdin is finished and the firmware sits
+ * waiting on an idle USART0 for more, the simulator exits.
+ *
+ * wait_ms spins on timer 2's interrupt count without touching a register, so a host timer
+ * signal every 50 us preempts it, advancing simulated time to timer 2's next interrupt and
+ * running it like the real interrupt would. The signal leaves time alone while the firmware
+ * is polling registers, since polling already advances it one access at a time, and when
+ * timer 2's interrupt is off, so code that only computes (and the tests that drive the
+ * simulated Create directly) runs in no simulated time.
+ *
+ * @date 10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "telemetry.h"
+#include "create_sim.h"
+#include "sim_avr.h"
+
+#define SIM_FOSC 16000000UL
+#define SIM_ACCESS_US 1    // simulated time per polled register access
+#define SIM_PREEMPT_US 1000 // most simulated time per host timer signal
+#define SIM_HOST_TICK_US 50 // host time between timer signals
+#define SIM_EOF_POLLS 1000 // polls of an idle USART0 after the end of stdin before the simulator exits
+#define SIM_TIMER1_US 4     // timer 1 tick with the 64 prescaler
+#define SIM_PING_HOLDOFF_US 750 // from the end of the trigger pulse to the start of the echo
+#define SIM_PING_NO_ECHO_US 18500 // echo length when nothing is in range
+#define SIM_PING_RANGE 3000.0 // mm, farthest post the ping sensor sees
+#define SIM_IR_RANGE 1500.0 // mm, farthest post the IR sensor sees
+#define SIM_ADC_US 104 // one conversion, 13 ADC clocks at 125 kHz
+
+volatile uint8_t sim_ucsr0a = (1 << UDRE), sim_ucsr0b, sim_ucsr1a = (1 << UDRE), sim_ucsr1b, sim_sreg, sim_adcsra;
+
+volatile uint8_t UDR1, UBRR1L, UBRR1H, UCSR1C;
+volatile uint8_t UBRR0L, UBRR0H, UCSR0C;
+volatile uint8_t DDRA, DDRB, DDRC, DDRD, DDRE;
+volatile uint8_t PORTA, PORTB, PORTC, PORTD, PORTE;
+volatile uint8_t PINA, PINB, PINC = 0x3F, PIND, PINE;
+volatile uint8_t TCCR0, OCR0, TCNT0, TCCR1A, TCCR1B, TCCR1C, TCCR2, OCR2, TCNT2;
+volatile uint8_t TCCR3A, TCCR3B, TCCR3C, TIMSK, TIFR, ETIMSK, ETIFR;
+volatile uint16_t ICR1, OCR3A, OCR3B, TCNT3;
+volatile uint8_t ADMUX, SFIOR;
+volatile uint16_t ADC = 20;
+#define SIM_IR_NOTHING 20 // IR sensor reading with nothing in range
+
+// USART1 interrupt handlers in open_interface.c
+void USART1_RX_vect(void);
+void USART1_UDRE_vect(void);
+// Timer 1 interrupt handlers in ping.c
+void TIMER1_OVF_vect(void);
+void TIMER1_CAPT_vect(void);
+void ADC_vect(void);
+// USART0 interrupt handler in serial.c
+void USART0_UDRE_vect(void);
+// Timer 0 and timer 2 interrupt handlers in util.c
+void TIMER0_COMP_vect(void);
+void TIMER2_COMP_vect(void);
+
+// Timer clock dividers selected by the low three bits of TCCR0 and TCCR2, 0 if stopped or clocked externally
+static const unsigned sim_timer0_prescale[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+static const unsigned sim_timer2_prescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+static unsigned long long sim_time_us = 0;
+static unsigned long long sim_next_rx_us = 0;
+static uint8_t sim_rx_data;
+static int sim_in_interrupt = 0;
+static volatile sig_atomic_t sim_depth = 0; // nonzero while the simulator itself is running
+static volatile sig_atomic_t sim_polled = 0; // the firmware advanced time itself since the last signal
+static volatile sig_atomic_t sim_preempting = 0;
+static int sim_timer1_overflow = 0; // overflow interrupt pending
+static int sim_timer1_capture = 0; // capture interrupt pending
+static int sim_trigger = 0; // ping trigger pin driven high
+static unsigned long sim_echo_length_us; // echo for the ping being triggered, aimed when the trigger started
+static unsigned long long sim_adc_done = 0; // when the running conversion finishes, 0 if none
+static unsigned long long sim_echo_rise = 0, sim_echo_fall = 0; // when the next echo starts and ends, 0 if none
+static int sim_timer0_compare = 0; // compare match interrupt pending
+static int sim_timer2_compare = 0;
+static unsigned long sim_timer2_interrupts = 0; // timer 2 interrupt handlers run so far
+static unsigned sim_timer0_cycles = 0, sim_timer2_cycles = 0; // CPU cycles toward the next timer tick
+static volatile uint8_t sim_ucsr0a_seen; // UCSR0A as the firmware's last read of it saw it
+static int sim_uart0_data = -1; // byte waiting in UDR0, -1 if none
+static int sim_uart0_shift = -1; // byte on the wire, -1 if none
+static unsigned long long sim_uart0_sent = 0; // when the byte on the wire is through
+static unsigned long long sim_uart0_next_rx = 0; // earliest time the next typed byte can arrive
+static uint8_t sim_uart0_rx_data;
+static int sim_uart0_eof = 0; // stdin is finished
+static int sim_uart0_idle_polls = 0; // polls of an idle USART0 since the end of stdin
+static int sim_frame_seen = 0, sim_frame_length = 0; // telemetry frame bytes passed and expected, 0 in text
+FILE *sim_serial_capture = NULL; // where everything USART0 sends goes, dropped if none
+
+// Baud rate USART1 is set to
+static unsigned long sim_uart1_baud(void) {
+	unsigned ubrr = (UBRR1H << 8) | UBRR1L;
+	unsigned long divisor = (sim_ucsr1a & (1 << U2X)) ? 8 : 16;
+	return SIM_FOSC / (divisor * (ubrr + 1));
+}
+
+// Baud rate USART0 is set to
+static unsigned long sim_uart0_baud(void) {
+	unsigned ubrr = (UBRR0H << 8) | UBRR0L;
+	unsigned long divisor = (sim_ucsr0a & (1 << U2X)) ? 8 : 16;
+	return SIM_FOSC / (divisor * (ubrr + 1));
+}
+
+// Both ends agree if their rates are within 3%
+static int sim_rates_match(void) {
+	double ratio = (double) sim_uart1_baud() / create_sim_baud();
+	return ratio > 0.97 && ratio < 1.03;
+}
+
+// Runs pending interrupt handlers if interrupts are enabled
+static void sim_interrupts(void) {
+	int guard;
+
+	if (sim_in_interrupt || !(sim_sreg & 0x80)) {
+		return;
+	}
+	sim_in_interrupt = 1;
+	sim_sreg &= ~0x80; // handlers run with interrupts disabled
+	if (sim_timer2_compare && (TIMSK & (1 << OCIE2))) {
+		sim_timer2_compare = 0;
+		TIFR &= ~(1 << OCF2);
+		sim_timer2_interrupts++;
+		TIMER2_COMP_vect();
+	}
+	if (sim_timer0_compare && (TIMSK & (1 << OCIE0))) {
+		sim_timer0_compare = 0;
+		TIFR &= ~(1 << OCF0);
+		TIMER0_COMP_vect();
+	}
+	for (guard = 0; (sim_ucsr1b & (1 << UDRIE)) && guard < 256; guard++) {
+		USART1_UDRE_vect();
+	}
+	for (guard = 0; (sim_ucsr0b & (1 << UDRIE)) && (sim_ucsr0a & (1 << UDRE)) && guard < 256; guard++) {
+		USART0_UDRE_vect();
+	}
+	if ((sim_ucsr1b & (1 << RXCIE)) && (sim_ucsr1a & (1 << RXC))) {
+		USART1_RX_vect();
+	}
+	if (sim_timer1_overflow && (TIMSK & (1 << TOIE1))) {
+		sim_timer1_overflow = 0;
+		TIFR &= ~(1 << TOV1);
+		TIMER1_OVF_vect();
+	}
+	if (sim_timer1_capture && (TIMSK & (1 << TICIE1))) {
+		sim_timer1_capture = 0;
+		TIMER1_CAPT_vect();
+	}
+	if ((sim_adcsra & (1 << ADIF)) && (sim_adcsra & (1 << ADIE))) {
+		sim_adcsra &= ~(1 << ADIF);
+		ADC_vect();
+	}
+	sim_sreg |= 0x80;
+	sim_in_interrupt = 0;
+}
+
+// Distance to the nearest post in the servo's direction, -1 if none
+static double sim_servo_range(void) {
+	double degrees = (OCR3B - 29) * 180.0 / 108 - 10; // inverse of move_servo's default formula
+	return create_sim_range((degrees - 90) * 3.14159265358979 / 180);
+}
+
+// IR sensor reading for the post in the servo's direction, inverting the IR calibration of robot 4
+static uint16_t sim_ir_reading(void) {
+	double range = sim_servo_range();
+
+	if (range < 0 || range > SIM_IR_RANGE) {
+		return SIM_IR_NOTHING;
+	}
+	double reading = pow(2364.5 / (range < 50 ? 5 : range / 10), 1 / 0.888);
+	return (uint16_t) (reading > 1023 ? 1023 : reading);
+}
+
+// Echo length for a ping fired in the servo's direction, using the ping calibration of robot 4
+static unsigned long sim_echo_us(void) {
+	double range = sim_servo_range();
+
+	if (range < 0 || range > SIM_PING_RANGE) {
+		return SIM_PING_NO_ECHO_US;
+	}
+	double ticks = (range / 10 - 3.6481622) / 0.06972973;
+	return (unsigned long) (ticks > 29 ? ticks * SIM_TIMER1_US : 115);
+}
+
+// Timer 1 overflow and input capture, and the ping sensor on the capture pin (PD4)
+static void sim_timer1_step(void) {
+	int trigger = (DDRD & 0x10) && (PORTD & 0x10);
+
+	if (!sim_trigger && trigger) { // trigger pulse started
+		sim_echo_length_us = sim_echo_us();
+	}
+	if (sim_trigger && !trigger) { // trigger pulse ended
+		sim_echo_rise = sim_time_us + SIM_PING_HOLDOFF_US;
+		sim_echo_fall = sim_echo_rise + sim_echo_length_us;
+	}
+	sim_trigger = trigger;
+	if (sim_time_us % (65536 * SIM_TIMER1_US) == 0) {
+		sim_timer1_overflow = 1;
+	}
+	if (sim_echo_rise && sim_time_us == sim_echo_rise && (TCCR1B & (1 << ICES1))) {
+		ICR1 = (uint16_t) (sim_time_us / SIM_TIMER1_US);
+		sim_timer1_capture = 1;
+	}
+	if (sim_echo_fall && sim_time_us == sim_echo_fall) {
+		if (!(TCCR1B & (1 << ICES1))) {
+			ICR1 = (uint16_t) (sim_time_us / SIM_TIMER1_US);
+			sim_timer1_capture = 1;
+		}
+		sim_echo_rise = sim_echo_fall = 0;
+	}
+	if (sim_timer1_overflow) {
+		TIFR |= (1 << TOV1); // firmware writes to TIFR clear it, the pending overflow sets it again
+	}
+	if (sim_timer1_overflow || sim_timer1_capture) {
+		sim_interrupts();
+	}
+}
+
+// Free running ADC conversions, which finish on their own instead of when the firmware looks at ADCSRA
+static void sim_adc_step(void) {
+	if (!(sim_adcsra & (1 << ADFR)) || !(sim_adcsra & (1 << ADEN)) || !(sim_adcsra & (1 << ADSC))) {
+		return;
+	}
+	if (!sim_adc_done) {
+		sim_adc_done = sim_time_us + SIM_ADC_US;
+	}
+	else if (sim_time_us >= sim_adc_done) {
+		ADC = sim_ir_reading();
+		sim_adcsra |= (1 << ADIF);
+		sim_adc_done = sim_time_us + SIM_ADC_US; // the next conversion starts right away
+		sim_interrupts();
+	}
+}
+
+// Counts an 8-bit timer through one microsecond; returns 1 if it matched its compare register.
+// In CTC mode (WGM01 and WGM21 are the same bit) the match clears the count.
+static int sim_timer_step(volatile uint8_t *count, uint8_t compare, uint8_t control, const unsigned prescale[8],
+                          unsigned *cycles) {
+	unsigned divider = prescale[control & 0x07];
+	int match = 0;
+
+	if (!divider) {
+		return 0;
+	}
+	for (*cycles += SIM_FOSC / 1000000; *cycles >= divider; *cycles -= divider) {
+		if (*count == compare) {
+			match = 1;
+			*count = (control & (1 << WGM01)) ? 0 : compare + 1;
+		}
+		else {
+			(*count)++;
+		}
+	}
+	return match;
+}
+
+// Timer 0 (the clock) and timer 2 (wait_ms)
+static void sim_timers_step(void) {
+	sim_timer0_compare |= sim_timer_step(&TCNT0, OCR0, TCCR0, sim_timer0_prescale, &sim_timer0_cycles);
+	sim_timer2_compare |= sim_timer_step(&TCNT2, OCR2, TCCR2, sim_timer2_prescale, &sim_timer2_cycles);
+	// firmware writes to TIFR clear the flags, the pending interrupts set them again
+	if (sim_timer0_compare) {
+		TIFR |= (1 << OCF0);
+	}
+	if (sim_timer2_compare) {
+		TIFR |= (1 << OCF2);
+	}
+	if (sim_timer0_compare || sim_timer2_compare) {
+		sim_interrupts();
+	}
+}
+
+// A byte USART0 finished sending: all of it goes to the capture file, the text to the terminal
+static void sim_uart0_out(uint8_t value) {
+	if (sim_serial_capture) {
+		fputc(value, sim_serial_capture);
+	}
+	if (sim_frame_length || value == TELEMETRY_SYNC) {
+		sim_frame_seen++;
+		if (sim_frame_seen == TELEMETRY_HEADER) {
+			sim_frame_length = TELEMETRY_HEADER + value + 1; // the last header byte is the payload length, then the CRC
+		}
+		else if (!sim_frame_length) {
+			sim_frame_length = TELEMETRY_HEADER + 1; // at least the header and CRC, until the length arrives
+		}
+		if (sim_frame_seen == sim_frame_length) {
+			sim_frame_seen = sim_frame_length = 0;
+		}
+	}
+	else if (value != '\r' && value != '\0') {
+		putchar(value);
+	}
+}
+
+// USART0: the byte on the wire, the next one waiting in UDR0, and bytes typed on stdin
+static void sim_uart0_step(void) {
+	unsigned long long byte_us = ((UCSR0C & (1 << USBS)) ? 11 : 10) * 1000000ULL / sim_uart0_baud();
+	struct pollfd input = {0, POLLIN, 0};
+	char typed;
+
+	if (sim_uart0_shift >= 0 && sim_time_us >= sim_uart0_sent) {
+		sim_uart0_out(sim_uart0_shift);
+		sim_uart0_shift = -1;
+	}
+	if (sim_uart0_shift < 0 && sim_uart0_data >= 0) {
+		sim_uart0_shift = sim_uart0_data;
+		sim_uart0_data = -1;
+		sim_uart0_sent = sim_time_us + byte_us;
+		sim_ucsr0a |= (1 << UDRE);
+		sim_interrupts();
+	}
+	if (!(sim_ucsr0b & (1 << RXEN)) || (sim_ucsr0a & (1 << RXC)) || sim_uart0_eof || sim_time_us < sim_uart0_next_rx) {
+		return;
+	}
+	sim_uart0_next_rx = sim_time_us + byte_us; // each typed byte takes a byte time on the wire
+	if (poll(&input, 1, 0) <= 0) {
+		return;
+	}
+	if (read(0, &typed, 1) != 1) {
+		sim_uart0_eof = 1;
+		return;
+	}
+	sim_uart0_rx_data = typed;
+	sim_ucsr0a |= (1 << RXC);
+	sim_interrupts();
+}
+
+uint16_t sim_tcnt1(void) {
+	sim_advance_us(SIM_ACCESS_US);
+	return (uint16_t) (sim_time_us / SIM_TIMER1_US);
+}
+
+void sim_advance_us(unsigned long us) {
+	unsigned long long byte_us = 10000000ULL / create_sim_baud(); // start + 8 data + stop bits
+
+	if (sim_depth == 0 && !sim_preempting) {
+		sim_polled = 1;
+	}
+	sim_depth++;
+	while (us--) {
+		sim_time_us++;
+		create_sim_advance(1e-6);
+		sim_timers_step();
+		sim_timer1_step();
+		sim_adc_step();
+		sim_uart0_step();
+		if (sim_time_us < sim_next_rx_us) {
+			continue;
+		}
+		uint8_t value;
+		if (!create_sim_tx(&value)) {
+			sim_next_rx_us = sim_time_us + byte_us; // next byte needs a full byte time on the wire
+			continue;
+		}
+		sim_next_rx_us = sim_time_us + byte_us;
+		if (sim_ucsr1a & (1 << RXC)) {
+			sim_ucsr1a |= (1 << DOR); // previous byte was never read
+		}
+		if (sim_rates_match()) {
+			sim_rx_data = value;
+			sim_ucsr1a &= ~(1 << FE);
+		}
+		else {
+			sim_rx_data = 0xFF;
+			sim_ucsr1a |= (1 << FE);
+		}
+		sim_ucsr1a |= (1 << RXC);
+		sim_interrupts();
+	}
+	sim_interrupts();
+	sim_depth--;
+}
+
+// Host timer signal: time passes while wait_ms counts timer 2's interrupts without touching a register
+static void sim_preempt(int signal) {
+	unsigned long interrupts = sim_timer2_interrupts;
+	int us;
+
+	if (sim_depth == 0 && !sim_polled && (TIMSK & (1 << OCIE2))) {
+		sim_preempting = 1;
+		for (us = 0; us < SIM_PREEMPT_US && sim_timer2_interrupts == interrupts; us++) {
+			sim_advance_us(1); // up to the next interrupt, so the wait ends at the same time however the signals fall
+		}
+		sim_preempting = 0;
+	}
+	sim_polled = 0;
+}
+
+void sim_avr_init(void) {
+	struct itimerval tick = {{0, SIM_HOST_TICK_US}, {0, SIM_HOST_TICK_US}};
+	signal(SIGALRM, sim_preempt);
+	setitimer(ITIMER_REAL, &tick, NULL);
+}
+
+unsigned long long sim_time(void) {
+	return sim_time_us;
+}
+
+volatile uint8_t *sim_io(volatile uint8_t *reg) {
+	if (reg == &sim_adcsra && (sim_adcsra & (1 << ADSC)) && !(sim_adcsra & (1 << ADFR))) {
+		if (!sim_adc_done) {
+			sim_adc_done = sim_time_us + SIM_ADC_US; // the first look at a started conversion starts its clock
+		}
+		else if (sim_time_us >= sim_adc_done) {
+			ADC = sim_ir_reading();
+			sim_adcsra &= ~(1 << ADSC);
+			sim_adcsra |= (1 << ADIF);
+			sim_adc_done = 0;
+		}
+	}
+	if (reg == &sim_ucsr0a) {
+		if (sim_uart0_eof && !(sim_ucsr0a & (1 << RXC)) && (sim_ucsr0a & (1 << UDRE)) && sim_uart0_shift < 0 &&
+		    !(sim_ucsr0b & (1 << UDRIE)) && ++sim_uart0_idle_polls > SIM_EOF_POLLS) {
+			exit(0); // waiting for input that will never come
+		}
+		// the firmware sees the status from before the interrupts its read lets in, as on the chip, so a
+		// data register empty interrupt can fill UDR0 between the firmware seeing it empty and writing it
+		sim_ucsr0a_seen = sim_ucsr0a;
+		sim_advance_us(SIM_ACCESS_US);
+		return &sim_ucsr0a_seen;
+	}
+	sim_advance_us(SIM_ACCESS_US);
+	return reg;
+}
+
+void sim_serial_drain(void) {
+	while ((sim_ucsr0b & (1 << UDRIE)) || sim_uart0_data >= 0 || sim_uart0_shift >= 0) {
+		sim_advance_us(1);
+	}
+	fflush(stdout);
+}
+
+uint8_t sim_uart0_read(void) {
+	sim_depth++;
+	sim_ucsr0a &= ~(1 << RXC);
+	sim_depth--;
+	return sim_uart0_rx_data;
+}
+
+void sim_uart0_write(uint8_t value) {
+	sim_depth++;
+	sim_uart0_data = value;
+	sim_ucsr0a &= ~(1 << UDRE);
+	sim_uart0_idle_polls = 0;
+	sim_depth--;
+}
+
+uint8_t sim_uart1_read(void) {
+	sim_depth++;
+	sim_ucsr1a &= ~((1 << RXC) | (1 << FE) | (1 << DOR));
+	sim_depth--;
+	return sim_rx_data;
+}
+
+void sim_uart1_write(uint8_t value) {
+	sim_depth++;
+	if (sim_rates_match()) {
+		create_sim_rx(value);
+	}
+	else {
+		create_sim_rx(value ^ 0x5A); // garbled at the wrong rate
+	}
+	sim_depth--;
+}
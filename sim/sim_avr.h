@@ -0,0 +1,27 @@
+/**
+ * sim_avr.h: simulated time for the host build of the firmware
+ *
+ * @date 10/17/2026
+ */
+
+#ifndef SIM_AVR_H
+#define SIM_AVR_H
+
+#include <stdio.h>
+
+/// Start the host timer that preempts the firmware like the real interrupts do
+void sim_avr_init(void);
+
+/// Advance simulated time, moving UART bytes and running interrupt handlers as they fall due
+void sim_advance_us(unsigned long us);
+
+/// Simulated time in microseconds since start
+unsigned long long sim_time(void);
+
+/// Advance simulated time until USART0 has sent everything the firmware gave it, so the terminal is up to date
+void sim_serial_drain(void);
+
+/// Where every byte the firmware sends on USART0 is written, text and telemetry alike, NULL to drop them
+extern FILE *sim_serial_capture;
+
+#endif
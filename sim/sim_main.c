@@ -0,0 +1,177 @@
+/**
+ * sim_main.c: runs the Rover firmware against the simulated Create on a laptop
+ *
+ * Build from the repository root:
+ *   gcc -std=gnu99 -funsigned-char -Isim -I. -o rover_sim sim/create_sim.c sim/sim_avr.c sim/sim_main.c \
+ *       util.c serial.c open_interface.c movement.c remoteControl.c script.c ping.c irsensor.c servo.c lcd.c audio.c pose.c hazard.c \
+ *       calibration.c colorCalibration.c segment.c grid.c telemetry.c track.c -lm
+ *
+ * Usage:
+ *   ./rover_sim [keys]      run the remote-control commands in keys (e.g. "wwdw"), or read them from stdin
+ *   ./rover_sim -b 1.02 ... scale the left wheel speed to make the robot drift
+ *   ./rover_sim -d ...      finish with the lateral drift per metre from the starting line, e.g.
+ *                           "./rover_sim -d -b 1.03 wwwwwwwwww" against "./rover_sim -d -b 1.03 hwwwwwwwwww"
+ *                           compares heading hold on and off
+ *   ./rover_sim -G 600,600  drive to a point (mm ahead, mm left) with motionGoTo before running the keys;
+ *                           -R 600,600 does the same by turning in place and driving straight, for comparison
+ *   ./rover_sim -g 300 ...  type the next key 300 ms after the last one instead of waiting for the
+ *                           motion queue to empty, so consecutive commands blend
+ *   ./rover_sim -t scans.bin bR  write everything sent to the terminal, scan telemetry included, to scans.bin,
+ *                           for tools/scandecode
+ *   ./rover_sim -m 0,-50 rrr  move the post in front of the robot 50 mm/s to the right, to follow it with the scans
+ *
+ * After each command the true pose, the firmware's odometry estimate, link traffic and simulated time
+ * are printed.
+ *
+ * @date 10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include "util.h"
+#include "serial.h"
+#include "ping.h"
+#include "open_interface.h"
+#include "movement.h"
+#include "remoteControl.h"
+#include "audio.h"
+#include "pose.h"
+#include "irsensor.h"
+#include "calibration.h"
+#include "grid.h"
+#include "create_sim.h"
+#include "sim_avr.h"
+
+static void report(char command) {
+	const create_sim_state_t *state = create_sim_state();
+	Pose pose;
+
+	sim_serial_drain();
+	poseGet(&pose);
+	printf("[sim %8.3f s] after '%c': x %7.1f mm  y %7.1f mm  heading %6.1f deg  in %lu B  out %lu B  frames %lu\n",
+	       sim_time() / 1e6, command, state->x, state->y, state->heading * 180.0 / 3.14159265358979,
+	       (unsigned long) state->bytes_in, (unsigned long) state->bytes_out, (unsigned long) state->frames);
+	printf("%*s odometry: x %7.1f mm  y %7.1f mm  heading %6.1f deg\n", 18, "",
+	       pose.x / 256.0, pose.y / 256.0, (int32_t) pose.theta * 360.0 / 4294967296.0);
+}
+
+int main(int argc, char **argv) {
+	ObjectPool currentObjects;
+	const char *keys = NULL;
+	unsigned long gap_ms = 0;
+	int drift = 0;
+	int goto_x = 0, goto_y = 0;
+	char goto_mode = 0;
+	int i;
+
+	create_sim_init();
+	sim_avr_init();
+	clock_init();
+	USART_Init(16); // 57600 baud, as Rover.c sets it
+	calibrationLoad();
+	ADC_init(); // starts the IR sampler
+	gridClear();
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			create_sim_set_wheel_bias(atof(argv[++i]));
+		}
+		else if ((strcmp(argv[i], "-G") == 0 || strcmp(argv[i], "-R") == 0) && i + 1 < argc) {
+			goto_mode = argv[i][1];
+			sscanf(argv[++i], "%d,%d", &goto_x, &goto_y);
+			if (!keys) {
+				keys = ""; // don't wait for keys on stdin afterwards
+			}
+		}
+		else if (strcmp(argv[i], "-d") == 0) {
+			drift = 1;
+		}
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			double vx = 0, vy = 0;
+			sscanf(argv[++i], "%lf,%lf", &vx, &vy);
+			create_sim_move_post(vx, vy);
+		}
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			sim_serial_capture = fopen(argv[++i], "wb");
+			if (!sim_serial_capture) {
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+			gap_ms = strtoul(argv[++i], NULL, 10);
+		}
+		else {
+			keys = argv[i];
+		}
+	}
+
+	oi_t *sensor_data = oi_alloc();
+	oi_init(sensor_data);
+	audioInit(sensor_data);
+	report('-');
+
+	if (goto_mode) {
+		unsigned long long start = sim_time();
+		if (goto_mode == 'G') {
+			motionGoTo(goto_x, goto_y);
+		}
+		else {
+			int bearing = (int) lround(atan2(goto_y, goto_x) * 180.0 / 3.14159265358979);
+			motionQueueCommand(MOTION_ROTATE, bearing, 0);
+			motionQueueCommand(MOTION_TRANSLATE, (int) lround(hypot(goto_x, goto_y)), 0);
+		}
+		motionWait(sensor_data);
+		sim_serial_drain();
+		const create_sim_state_t *state = create_sim_state();
+		printf("goto (%d, %d): %.3f s, ended %.1f mm from the target\n", goto_x, goto_y,
+		       (sim_time() - start) / 1e6, hypot(state->x - goto_x, state->y - goto_y));
+		report(goto_mode);
+	}
+
+	while (1) {
+		char received;
+		if (keys) {
+			if (*keys == '\0') {
+				break;
+			}
+			received = *keys++;
+		}
+		else {
+			if (isatty(0)) {
+				printf("> ");
+				fflush(stdout);
+			}
+			received = serial_getc();
+			if (received == '\n') {
+				continue;
+			}
+		}
+		takeDirectionInput(received, sensor_data, &currentObjects);
+		if (gap_ms) {
+			unsigned long long next_key = sim_time() + 1000ULL * gap_ms;
+			while (sim_time() < next_key) {
+				motionUpdate(sensor_data); // the main loop between keystrokes
+			}
+		}
+		else {
+			motionWait(sensor_data);
+			wait_ms(100); // let a script or the last stream frames finish before reporting
+		}
+		report(received);
+	}
+	motionWait(sensor_data);
+	wait_ms(100);
+	report('.');
+	if (drift) {
+		const create_sim_state_t *state = create_sim_state();
+		printf("drift: %.1f mm sideways over %.1f mm, %.1f mm per metre\n",
+		       state->y, state->x, state->x > 0 ? 1000.0 * state->y / state->x : 0.0);
+	}
+	printf("stream errors: %u\n", oi_stream_errors());
+	oi_free(sensor_data);
+	return 0;
+}
@@ -0,0 +1,1059 @@
+/**
+ * sim_test.c: host tests for the firmware, run against the simulated Create
+ *
+ * Build from the repository root:
+ *   gcc -std=gnu99 -funsigned-char -Isim -I. -o rover_test sim/create_sim.c sim/sim_avr.c sim/sim_test.c \
+ *       util.c serial.c open_interface.c movement.c remoteControl.c script.c ping.c irsensor.c servo.c lcd.c audio.c pose.c hazard.c \
+ *       calibration.c colorCalibration.c segment.c grid.c telemetry.c track.c -lm
+ *
+ * Usage:
+ *   ./rover_test            run every test; the exit status is 1 if any check failed
+ *   ./rover_test stream     run only the named tests
+ *
+ * Each check prints one line, so a failure shows the values that were compared.
+ *
+ * @date 10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "util.h"
+#include "serial.h"
+#include "open_interface.h"
+#include "pose.h"
+#include "movement.h"
+#include "ping.h"
+#include "irsensor.h"
+#include "calibration.h"
+#include "hazard.h"
+#include "segment.h"
+#include "remoteControl.h"
+#include "create_sim.h"
+#include "sim_avr.h"
+
+#define TEST_STREAM_FRAMES 20
+#define TEST_STREAM_SIZE 1024
+#define TEST_PI 3.14159265358979323846
+
+static int test_checks = 0;
+static int test_failures = 0;
+static int test_booted = 0; // test_boot() has run, so the firmware may be streaming
+
+// Records one check and prints it
+static void check(int ok, const char *format, ...) {
+	va_list args;
+
+	test_checks++;
+	if (!ok) {
+		test_failures++;
+	}
+	printf("  %s ", ok ? "ok  " : "FAIL");
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+}
+
+// ---------------------------------------------------------------- stream frame parser
+
+// Records stream frames from the simulated Create driving straight over plain floor.
+// Returns the number of bytes recorded; frame_start gets the offset of each frame.
+static int test_record_stream(uint8_t *bytes, int frame_start[TEST_STREAM_FRAMES]) {
+	static const uint8_t setup[] = {
+		OI_OPCODE_START, OI_OPCODE_FULL,
+		OI_OPCODE_DRIVE_WHEELS, 0, 100, 0, 100,
+		OI_OPCODE_STREAM, 11, 7, 9, 10, 11, 12, 19, 20, 28, 29, 30, 31,
+	};
+	static const uint8_t pause[] = {OI_OPCODE_DO_STREAM, 0};
+	int length = 0;
+	unsigned i;
+	uint8_t value;
+
+	create_sim_init();
+	for (i = 0; i < sizeof(setup); i++) {
+		create_sim_rx(setup[i]);
+	}
+	while (create_sim_state()->frames < TEST_STREAM_FRAMES) {
+		uint32_t frames = create_sim_state()->frames;
+		create_sim_advance(0.001);
+		if (create_sim_state()->frames != frames) {
+			frame_start[frames] = length;
+		}
+		while (create_sim_tx(&value) && length < TEST_STREAM_SIZE) {
+			bytes[length++] = value;
+		}
+	}
+	for (i = 0; i < sizeof(pause); i++) {
+		create_sim_rx(pause[i]); // nothing may reach the firmware's USART while the test runs
+	}
+	return length;
+}
+
+// Feeds bytes to the frame parser and checks how many frames it accepted and how many errors it counted
+static void test_parse(const char *name, const uint8_t *bytes, int length, int accepted, int rejected) {
+	uint16_t errors = oi_stream_errors();
+	int frames = 0;
+	int i;
+
+	for (i = 0; i < length; i++) {
+		frames += oi_stream_parse(bytes[i]);
+	}
+	check(frames == accepted, "%s: %d frames accepted, expected %d", name, frames, accepted);
+	check((uint16_t) (oi_stream_errors() - errors) == rejected, "%s: %u errors counted, expected %d",
+	      name, (uint16_t) (oi_stream_errors() - errors), rejected);
+}
+
+// Checks the fields of the last accepted frame against the floor the recording was made on
+static void test_floor_frame(const char *name) {
+	oi_t frame;
+
+	oi_snapshot(&frame);
+	check(frame.cliff_left_signal == 300 && frame.cliff_frontleft_signal == 60 &&
+	      frame.cliff_frontright_signal == 500 && frame.cliff_right_signal == 600,
+	      "%s: cliff signals %u %u %u %u, expected 300 60 500 600", name, frame.cliff_left_signal,
+	      frame.cliff_frontleft_signal, frame.cliff_frontright_signal, frame.cliff_right_signal);
+	check(!frame.bumper_left && !frame.bumper_right && !frame.cliff_left && !frame.cliff_right,
+	      "%s: no bumper or cliff flags", name);
+	check(frame.distance >= 1 && frame.distance <= 2, "%s: distance %d mm in the last frame, expected 1-2",
+	      name, frame.distance);
+}
+
+// A recorded stream, then copies with a bad checksum, a truncated frame and wrong length bytes
+static void test_stream(void) {
+	uint8_t recorded[TEST_STREAM_SIZE];
+	uint8_t bytes[TEST_STREAM_SIZE];
+	int frame_start[TEST_STREAM_FRAMES];
+	int length;
+	int frame_length;
+	oi_t before, after;
+
+	if (test_booted) {
+		oi_stream_stop(); // the recording goes straight to the parser
+	}
+	length = test_record_stream(recorded, frame_start);
+	frame_length = frame_start[1] - frame_start[0];
+
+	check(length == TEST_STREAM_FRAMES * 31, "recorded %d frames, %d bytes", TEST_STREAM_FRAMES, length);
+
+	oi_snapshot(&before);
+	test_parse("recorded", recorded, length, TEST_STREAM_FRAMES, 0);
+	oi_snapshot(&after);
+	check(after.frame_number - before.frame_number == TEST_STREAM_FRAMES, "recorded: frame number advanced by %lu",
+	      (unsigned long) (after.frame_number - before.frame_number));
+	check(fabs(after.distance_total - create_sim_state()->travelled) < 1.0,
+	      "recorded: distance total %ld mm, the model drove %.1f mm", (long) after.distance_total,
+	      create_sim_state()->travelled);
+	test_floor_frame("recorded");
+
+	memcpy(bytes, recorded, length);
+	bytes[frame_start[5] + frame_length - 1]++;
+	test_parse("bad checksum", bytes, length, TEST_STREAM_FRAMES - 1, 1);
+	test_floor_frame("bad checksum");
+
+	// the truncated frame swallows the start of the next one, so both are lost
+	memcpy(bytes, recorded, frame_start[5] + frame_length - 10);
+	memcpy(bytes + frame_start[5] + frame_length - 10, recorded + frame_start[6], length - frame_start[6]);
+	test_parse("truncated frame", bytes, length - 10, TEST_STREAM_FRAMES - 2, 2);
+	test_floor_frame("truncated frame");
+
+	// resynchronizing inside a dropped frame stops at packet id 19, which looks like a header;
+	// the high byte of the distance after it is a zero length, the second error
+	memcpy(bytes, recorded, length);
+	bytes[frame_start[5] + 1] = 0;
+	test_parse("zero length", bytes, length, TEST_STREAM_FRAMES - 1, 2);
+	bytes[frame_start[5] + 1] = OI_STREAM_MAX_PAYLOAD + 1;
+	test_parse("oversized length", bytes, length, TEST_STREAM_FRAMES - 1, 2);
+	bytes[frame_start[5] + 1] = frame_length - 4; // one byte short: the checksum check fails
+	test_parse("short length", bytes, length, TEST_STREAM_FRAMES - 1, 1);
+	bytes[frame_start[5] + 1] = frame_length - 2; // one byte long: runs into the next frame
+	test_parse("long length", bytes, length, TEST_STREAM_FRAMES - 2, 2);
+	test_floor_frame("wrong lengths");
+
+	// a frame cut off by the end of the data is neither accepted nor counted yet; the first frame
+	// after it completes its payload and is lost with it, then the parser resynchronizes as above
+	test_parse("cut off at the end", recorded, length - 5, TEST_STREAM_FRAMES - 1, 0);
+	test_parse("cut off, then resent", recorded, length, TEST_STREAM_FRAMES - 1, 2);
+}
+
+// ---------------------------------------------------------------- firmware against the model
+
+// Powers the model on and runs oi_init, which leaves the sensor stream running
+static oi_t *test_boot(void) {
+	static oi_t sensor_data;
+
+	if (test_booted) {
+		oi_stream_stop(); // oi_init talks to the Create directly, without the receive interrupt
+	}
+	test_booted = 1;
+	calibrationDefaults(); // what boot loads from a blank EEPROM
+	create_sim_init();
+	memset(&sensor_data, 0, sizeof(sensor_data));
+	oi_init(&sensor_data);
+	return &sensor_data;
+}
+
+// Boots against a Create that refuses or garbles some rates and checks where the link ends up
+static void test_link(const char *name, unsigned long expected, int streams) {
+	oi_t *sensor_data = test_boot();
+	uint16_t errors = oi_stream_errors();
+	uint32_t frame;
+
+	check(create_sim_baud() == expected, "%s: the Create ends up at %lu baud, expected %lu", name,
+	      create_sim_baud(), expected);
+	if (!streams) {
+		return;
+	}
+	// the model takes commands the moment they are written, so a round trip is at most one reply byte on the wire
+	check(oi_link_latency() >= 5000000UL / expected && oi_link_latency() < 1000, "%s: %lu us round trip", name, oi_link_latency());
+	oi_update(sensor_data);
+	frame = sensor_data->frame_number;
+	wait_ms(300);
+	oi_update(sensor_data);
+	check(sensor_data->frame_number - frame >= 19 && oi_stream_errors() == errors,
+	      "%s: both ends agree, %lu frames in 300 ms and %u stream errors", name,
+	      (unsigned long) (sensor_data->frame_number - frame), oi_stream_errors() - errors);
+}
+
+// Link rate negotiation when the Create doesn't switch or a rate is unreliable
+static void test_baud(void) {
+	test_link("every rate works", 115200, 1);
+
+	create_sim_refuse_baud(115200, 1);
+	test_link("115200 refused", 57600, 1);
+
+	// 38400 fails without the Create switching; the 28800 command must still be sent at 57600
+	create_sim_refuse_baud(38400, 1);
+	create_sim_garble_baud(57600, 1);
+	test_link("115200 and 38400 refused, 57600 garbled", 28800, 1);
+
+	create_sim_garble_baud(115200, 1);
+	create_sim_garble_baud(38400, 1);
+	create_sim_garble_baud(28800, 1);
+	create_sim_refuse_baud(115200, 0);
+	create_sim_refuse_baud(38400, 0);
+	test_link("every rate garbled", 28800, 0);
+	check(oi_link_latency() == 0, "every rate garbled: no latency reported");
+
+	create_sim_garble_baud(115200, 0);
+	create_sim_garble_baud(57600, 0);
+	create_sim_garble_baud(38400, 0);
+	create_sim_garble_baud(28800, 0);
+}
+
+// Streams the registered packets for 300 ms and checks every frame arrived intact
+static void test_packet_stream(const char *name, oi_t *sensor_data) {
+	uint16_t errors = oi_stream_errors();
+	uint32_t frame;
+
+	oi_update(sensor_data);
+	frame = sensor_data->frame_number;
+	wait_ms(300);
+	oi_update(sensor_data);
+	check(sensor_data->frame_number - frame >= 19 && oi_stream_errors() == errors,
+	      "%s: %lu frames in 300 ms, %u stream errors", name, (unsigned long) (sensor_data->frame_number - frame),
+	      oi_stream_errors() - errors);
+}
+
+// Registering more packets than a stream frame holds at the negotiated link rate
+static void test_packet_list(void) {
+	static const uint8_t all[OI_MAX_PACKET_LIST] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+		25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42,
+	};
+	oi_t *sensor_data = test_boot();
+	uint32_t bytes_in;
+
+	// at 115200 the parser's 64 bytes are the limit: packets 7-32 take 63 with their ids, packet 33 would need 3 more
+	bytes_in = create_sim_state()->bytes_in;
+	check(oi_set_packets(all, sizeof(all)) == 0 && create_sim_state()->bytes_in == bytes_in,
+	      "115200: all of packets 7-42 rejected, nothing sent");
+	check(oi_set_packets(all, 27) == 0, "115200: packets 7-33 rejected");
+	check(oi_set_packets(all, 26) == 26, "115200: packets 7-32 registered");
+	bytes_in = create_sim_state()->bytes_in;
+	check(oi_set_packets(all, 26) == 26 && create_sim_state()->bytes_in == bytes_in,
+	      "registering the same list again sends nothing");
+	test_packet_stream("115200, packets 7-32", sensor_data);
+	check(sensor_data->voltage == 15000 && sensor_data->cliff_right_signal == 600,
+	      "voltage %u mV and right cliff signal %u streamed", sensor_data->voltage, sensor_data->cliff_right_signal);
+	oi_set_packets(NULL, 0);
+
+	// at 28800 a 15 ms stream period carries 43 bytes, 40 of them payload: packets 7-24 exactly
+	create_sim_refuse_baud(115200, 1);
+	create_sim_refuse_baud(38400, 1);
+	create_sim_garble_baud(57600, 1);
+	sensor_data = test_boot();
+	check(create_sim_baud() == 28800, "link at %lu baud", create_sim_baud());
+	check(oi_set_packets(all, 26) == 0, "28800: packets 7-32 rejected");
+	check(oi_set_packets(all, 19) == 0, "28800: packets 7-25 rejected");
+	test_packet_stream("28800, the default set kept", sensor_data);
+	check(oi_set_packets(all, 18) == 18, "28800: packets 7-24 registered");
+	test_packet_stream("28800, packets 7-24", sensor_data);
+	oi_set_packets(NULL, 0);
+	create_sim_refuse_baud(115200, 0);
+	create_sim_refuse_baud(38400, 0);
+	create_sim_garble_baud(57600, 0);
+	test_boot();
+}
+
+// Runs the motion engine for ms of simulated time and returns the payload bytes of the Create's last stream frame
+static int test_frame_length(oi_t *sensor_data, unsigned long ms) {
+	unsigned long long end = sim_time() + 1000ULL * ms;
+
+	while (sim_time() < end) {
+		motionUpdate(sensor_data);
+		sim_advance_us(100); // an idle engine returns without touching the clock
+	}
+	return create_sim_state()->frame_length;
+}
+
+// The motion engine streams only the packets the running command reads, and the drive set while idle
+static void test_motion_packets(void) {
+	oi_t *sensor_data = test_boot();
+	int length;
+
+	length = test_frame_length(sensor_data, 50);
+	check(length == 28, "idle: %d payload bytes per frame, the drive set", length);
+
+	motionQueueCommand(MOTION_ROTATE, 90, 0);
+	length = test_frame_length(sensor_data, 100);
+	check(length == 25, "rotating: %d payload bytes per frame, without the distance", length);
+	motionWait(sensor_data);
+	check(fabs(create_sim_state()->heading * 180 / TEST_PI - 90) < 3, "rotated to %.1f degrees",
+	      create_sim_state()->heading * 180 / TEST_PI);
+
+	motionQueueCommand(MOTION_TRANSLATE, 300, 0);
+	length = test_frame_length(sensor_data, 100);
+	check(length == 28, "translating: %d payload bytes per frame, the drive set", length);
+	motionWait(sensor_data);
+	length = test_frame_length(sensor_data, 50);
+	check(length == 28, "idle again: %d payload bytes per frame", length);
+}
+
+// Turns the robot with a remote-control key and checks it turned the announced angle, the model coasting after the stop
+static void test_turn_key(oi_t *sensor_data, char key, double expected) {
+	ObjectPool objects;
+	double before = create_sim_state()->heading * 180 / TEST_PI;
+	double turned;
+
+	takeDirectionInput(key, sensor_data, &objects);
+	motionWait(sensor_data);
+	wait_ms(200); // any coast is over by now
+	turned = remainder(create_sim_state()->heading * 180 / TEST_PI - before, 360);
+	check(fabs(turned - expected) < 3, "'%c' turned %.1f degrees, expected %.0f", key, turned, expected);
+}
+
+// Rotations slow down before they stop, so they end where they were aimed
+static void test_turns(void) {
+	oi_t *sensor_data = test_boot();
+
+	test_turn_key(sensor_data, 'a', 90);
+	test_turn_key(sensor_data, 'd', -90);
+	test_turn_key(sensor_data, 'q', 15);
+	test_turn_key(sensor_data, 'e', -15);
+}
+
+// ---------------------------------------------------------------- clock and terminal
+
+// The millisecond clock, and text sent both ways serial.c has, through the simulated USART0
+static void test_serial(void) {
+	static const char queued[] = "  sent: queued";
+	static const char direct[] = " then direct\n";
+	char wire[64];
+	unsigned long us, last, start_ms;
+	unsigned long long start;
+	int backwards = 0, length;
+	unsigned i;
+	FILE *capture = sim_serial_capture;
+
+	if (test_booted) {
+		oi_stream_stop(); // the receive interrupt can't keep up with interrupts held off below
+	}
+	// a millisecond boundary with interrupts off: timer 0's pending compare flag stands in for the missed count
+	start_ms = clock_ms();
+	while (clock_ms() == start_ms || clock_us() % 1000 < 500) {
+	}
+	start = sim_time();
+	cli();
+	last = us = clock_us();
+	while (sim_time() - start < 800) {
+		us = clock_us();
+		backwards |= us < last;
+		last = us;
+	}
+	sei();
+	check(!backwards && clock_ms() == start_ms + 2, "clock_us kept counting past %lu ms with interrupts off, to %lu us",
+	      start_ms + 2, us);
+	start = sim_time();
+	us = clock_us();
+	wait_ms(20);
+	check(labs((long) (clock_us() - us) - (long) (sim_time() - start)) <= 8, "wait_ms(20): clock_us counted %lu us, %llu us passed",
+	      clock_us() - us, sim_time() - start);
+
+	// bytes written directly wait for the queued ones, and everything goes out at 57600 baud with 2 stop bits
+	sim_serial_capture = tmpfile();
+	start = sim_time();
+	check(serial_try_put((const uint8_t *) queued, strlen(queued)), "serial_try_put queued %d bytes", (int) strlen(queued));
+	serial_putString((char *) direct, strlen(direct));
+	sim_serial_drain();
+	rewind(sim_serial_capture);
+	length = fread(wire, 1, sizeof(wire) - 1, sim_serial_capture);
+	wire[length] = '\0';
+	fclose(sim_serial_capture);
+	check(length == (int) (strlen(queued) + strlen(direct)) && strncmp(wire, queued, strlen(queued)) == 0 &&
+	      strcmp(wire + strlen(queued), direct) == 0, "the direct bytes follow the queued ones, %d bytes on the wire", length);
+	// UBRR 16 makes a bit 17 us long (58824 baud, the closest 16 MHz gets to 57600); a byte is 11 bits
+	check(sim_time() - start >= length * 11 * 17ULL && sim_time() - start < (length + 1) * 11 * 17ULL,
+	      "%d bytes took %llu us on the wire", length, sim_time() - start);
+
+	// a full queue takes nothing more until the interrupt has made room
+	sim_serial_capture = NULL;
+	memset(wire, 0, sizeof(wire));
+	cli();
+	for (i = 0; i < (SERIAL_TX_BUFFER_SIZE - 1) / sizeof(wire); i++) {
+		serial_try_put((const uint8_t *) wire, sizeof(wire));
+	}
+	check(serial_try_put((const uint8_t *) wire, (SERIAL_TX_BUFFER_SIZE - 1) % sizeof(wire)) &&
+	      !serial_try_put((const uint8_t *) wire, 1), "serial_try_put takes %d bytes at most", SERIAL_TX_BUFFER_SIZE - 1);
+	sei();
+	wait_ms(1);
+	check(serial_try_put((const uint8_t *) wire, 1), "serial_try_put takes more once the interrupt sent some");
+	sim_serial_drain();
+	sim_serial_capture = capture;
+}
+
+// ---------------------------------------------------------------- sensor packet descriptors
+
+// One field of oi_t as the Open Interface manual describes its packet
+typedef struct {
+	uint8_t id;
+	const char *name;
+	uint8_t offset;       // offsetof(oi_t, field)
+	uint8_t size;         // sizeof the field
+	uint8_t field_signed; // whether the field's type is signed
+	uint8_t width;        // data bytes in the packet, from the manual
+	uint8_t is_signed;    // whether the manual says the packet is signed
+	int8_t bit;           // flag bit within a one-byte packet, -1 for the whole packet
+} test_field_t;
+
+#define TEST_FIELD_TYPE(field) __typeof__(((oi_t *) 0)->field)
+#define TEST_FIELD(id, field, width, is_signed, bit) \
+	{id, #field, offsetof(oi_t, field), sizeof(TEST_FIELD_TYPE(field)), (TEST_FIELD_TYPE(field)) -1 < 0, width, is_signed, bit}
+
+// Every packet from 7 to 42, in the manual's words
+static const test_field_t test_fields[] = {
+	TEST_FIELD(7, bumper_right, 1, 0, 0),
+	TEST_FIELD(7, bumper_left, 1, 0, 1),
+	TEST_FIELD(7, wheeldrop_right, 1, 0, 2),
+	TEST_FIELD(7, wheeldrop_left, 1, 0, 3),
+	TEST_FIELD(7, wheeldrop_caster, 1, 0, 4),
+	TEST_FIELD(8, wall, 1, 0, -1),
+	TEST_FIELD(9, cliff_left, 1, 0, -1),
+	TEST_FIELD(10, cliff_frontleft, 1, 0, -1),
+	TEST_FIELD(11, cliff_frontright, 1, 0, -1),
+	TEST_FIELD(12, cliff_right, 1, 0, -1),
+	TEST_FIELD(13, virtual_wall, 1, 0, -1),
+	TEST_FIELD(14, overcurrent_ld1, 1, 0, 0),
+	TEST_FIELD(14, overcurrent_ld0, 1, 0, 1),
+	TEST_FIELD(14, overcurrent_ld2, 1, 0, 2),
+	TEST_FIELD(14, overcurrent_driveright, 1, 0, 3),
+	TEST_FIELD(14, overcurrent_driveleft, 1, 0, 4),
+	TEST_FIELD(17, infrared_byte, 1, 0, -1),
+	TEST_FIELD(18, button_play, 1, 0, 0),
+	TEST_FIELD(18, button_advance, 1, 0, 2),
+	TEST_FIELD(19, distance, 2, 1, -1),
+	TEST_FIELD(20, angle, 2, 1, -1),
+	TEST_FIELD(21, charging_state, 1, 0, -1),
+	TEST_FIELD(22, voltage, 2, 0, -1),
+	TEST_FIELD(23, current, 2, 1, -1),
+	TEST_FIELD(24, temperature, 1, 1, -1),
+	TEST_FIELD(25, charge, 2, 0, -1),
+	TEST_FIELD(26, capacity, 2, 0, -1),
+	TEST_FIELD(27, wall_signal, 2, 0, -1),
+	TEST_FIELD(28, cliff_left_signal, 2, 0, -1),
+	TEST_FIELD(29, cliff_frontleft_signal, 2, 0, -1),
+	TEST_FIELD(30, cliff_frontright_signal, 2, 0, -1),
+	TEST_FIELD(31, cliff_right_signal, 2, 0, -1),
+	TEST_FIELD(32, cargo_bay_io0, 1, 0, 0),
+	TEST_FIELD(32, cargo_bay_io1, 1, 0, 1),
+	TEST_FIELD(32, cargo_bay_io2, 1, 0, 2),
+	TEST_FIELD(32, cargo_bay_io3, 1, 0, 3),
+	TEST_FIELD(32, cargo_bay_baud, 1, 0, 4),
+	TEST_FIELD(33, cargo_bay_voltage, 2, 0, -1),
+	TEST_FIELD(34, internal_charger_on, 1, 0, 0),
+	TEST_FIELD(34, home_base_charger_on, 1, 0, 1),
+	TEST_FIELD(35, oi_mode, 1, 0, -1),
+	TEST_FIELD(36, song_number, 1, 0, -1),
+	TEST_FIELD(37, song_playing, 1, 0, -1),
+	TEST_FIELD(38, number_packets, 1, 0, -1),
+	TEST_FIELD(39, requested_velocity, 2, 1, -1),
+	TEST_FIELD(40, requested_radius, 2, 1, -1),
+	TEST_FIELD(41, requested_right_velocity, 2, 1, -1),
+	TEST_FIELD(42, requested_left_velocity, 2, 1, -1),
+};
+#define TEST_FIELDS (sizeof(test_fields) / sizeof(test_fields[0]))
+
+// Data bytes of a packet, one or two of them
+static long test_raw(const test_field_t *f, const uint8_t *data) {
+	return (f->width == 2) ? (data[0] << 8) | data[1] : data[0];
+}
+
+// The value the manual says the data bytes stand for
+static long test_expected(const test_field_t *f, const uint8_t *data) {
+	long raw = test_raw(f, data);
+
+	if (f->bit >= 0) {
+		return (raw >> f->bit) & 1;
+	}
+	if (f->is_signed) {
+		return (f->width == 2) ? (int16_t) raw : (int8_t) raw;
+	}
+	return raw;
+}
+
+// A field's value read through its type in oi_t
+static long test_read(const test_field_t *f, const oi_t *frame) {
+	const uint8_t *field = (const uint8_t *) frame + f->offset;
+
+	if (f->size == 2) {
+		return f->field_signed ? *(const int16_t *) field : *(const uint16_t *) field;
+	}
+	return f->field_signed ? *(const int8_t *) field : *(const uint8_t *) field;
+}
+
+// Parses a stream frame that carries one packet
+static void test_parse_packet(uint8_t id, const uint8_t *data, uint8_t width) {
+	uint8_t frame[5] = {OI_STREAM_HEADER, 1 + width, id, data[0], data[1]};
+	uint8_t sum = 0;
+	uint8_t i;
+
+	for (i = 0; i < 3 + width; i++) {
+		oi_stream_parse(frame[i]);
+		sum += frame[i];
+	}
+	oi_stream_parse((uint8_t) -sum);
+}
+
+// Whether a byte of oi_t belongs to the fields of a packet id
+static int test_packet_byte(uint8_t id, unsigned byte) {
+	unsigned f;
+
+	for (f = 0; f < TEST_FIELDS; f++) {
+		if (test_fields[f].id == id && byte >= test_fields[f].offset && byte < test_fields[f].offset + test_fields[f].size) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Each packet alone in a stream frame: every field gets the manual's value and no other byte of oi_t changes
+static void test_packets_single(void) {
+	uint8_t id;
+	unsigned f;
+
+	if (test_booted) {
+		oi_stream_stop(); // the frames below go straight to the parser
+	}
+	for (id = 7; id <= 42; id++) {
+		uint8_t data[2] = {0x80 | id, id};
+		uint8_t inverse[2] = {~data[0], ~data[1]};
+		uint8_t width = 0;
+		oi_t before, after;
+		unsigned byte;
+		int changed = 0, stray = 0;
+
+		for (f = 0; f < TEST_FIELDS; f++) {
+			if (test_fields[f].id == id) {
+				width = test_fields[f].width;
+			}
+		}
+		if (width == 0) {
+			width = 1; // packets 15 and 16 are unused: decoded into nothing
+		}
+		test_parse_packet(id, inverse, width);
+		oi_snapshot(&before);
+		test_parse_packet(id, data, width);
+		oi_snapshot(&after);
+		for (f = 0; f < TEST_FIELDS; f++) {
+			const test_field_t *field = &test_fields[f];
+			if (field->id != id) {
+				continue;
+			}
+			check(field->size >= field->width || field->bit >= 0, "packet %u %s: %u byte field for %u data bytes",
+			      id, field->name, field->size, field->width);
+			check(field->bit >= 0 || field->width == 1 || field->field_signed == field->is_signed,
+			      "packet %u %s: field is %s, the packet %s", id, field->name,
+			      field->field_signed ? "signed" : "unsigned", field->is_signed ? "signed" : "unsigned");
+			check(test_read(field, &after) == test_expected(field, data), "packet %u %s: decoded %ld, expected %ld",
+			      id, field->name, test_read(field, &after), test_expected(field, data));
+		}
+		for (byte = offsetof(oi_t, distance); byte < sizeof(oi_t); byte++) {
+			if (((uint8_t *) &before)[byte] != ((uint8_t *) &after)[byte]) {
+				changed++;
+				stray += !test_packet_byte(id, byte);
+			}
+		}
+		check(stray == 0 && (id == 15 || id == 16 || changed > 0),
+		      "packet %u: %d bytes of oi_t changed, %d outside its fields", id, changed, stray);
+	}
+}
+
+// A whole group 6 reply decoded in one pass, with packet 35 at byte 40
+static void test_packets_group6(void) {
+	oi_t *sensor_data = test_boot();
+	uint8_t offset = 0;
+	uint8_t id;
+	unsigned f;
+
+	oi_stream_stop();
+	oi_set_packets(NULL, 0); // polled updates read the whole of group 6
+	create_sim_sensor_pattern(1);
+	oi_update(sensor_data);
+	create_sim_sensor_pattern(0);
+
+	for (id = 7; id <= 42; id++) {
+		uint8_t width = 1;
+		for (f = 0; f < TEST_FIELDS; f++) {
+			const test_field_t *field = &test_fields[f];
+			uint8_t data[2] = {0x80 | id, id};
+			if (field->id != id) {
+				continue;
+			}
+			width = field->width;
+			if (id == 35) {
+				check(offset == 40, "group 6: packet 35 starts at byte %u of the reply", offset);
+			}
+			// distance and angle become the motion since the struct's last update, which adds nothing here
+			check(test_read(field, sensor_data) == test_expected(field, data),
+			      "group 6 byte %u, packet %u %s: decoded %ld, expected %ld", offset, id, field->name,
+			      test_read(field, sensor_data), test_expected(field, data));
+		}
+		offset += width;
+	}
+	check(offset == 52, "group 6 is %u bytes", offset);
+	poseReset(); // the pattern's distance and angle moved the pose
+}
+
+// Every packet id through the descriptor table, alone and as part of group 6
+static void test_packets(void) {
+	test_packets_single();
+	test_packets_group6();
+}
+
+// ---------------------------------------------------------------- odometry
+
+#define TEST_TRACE_SIZE 2000
+
+typedef struct {
+	int16_t distance;
+	int16_t angle;
+} test_motion_t;
+
+// Drives the simulated Create through wheel speed legs and records the distance and angle of every stream frame
+static int test_record_trace(const int16_t legs[][3], int count, test_motion_t *trace) {
+	static const uint8_t setup[] = {OI_OPCODE_START, OI_OPCODE_FULL, OI_OPCODE_STREAM, 2, 19, 20};
+	uint8_t frame[9];
+	uint8_t have = 0;
+	int frames = 0;
+	int leg;
+	unsigned i;
+	uint8_t value;
+
+	create_sim_init();
+	for (i = 0; i < sizeof(setup); i++) {
+		create_sim_rx(setup[i]);
+	}
+	for (leg = 0; leg < count; leg++) {
+		uint8_t wheels[5] = {OI_OPCODE_DRIVE_WHEELS, legs[leg][0] >> 8, legs[leg][0] & 0xff, legs[leg][1] >> 8, legs[leg][1] & 0xff};
+		int ms;
+		for (i = 0; i < sizeof(wheels); i++) {
+			create_sim_rx(wheels[i]);
+		}
+		for (ms = 0; ms < legs[leg][2]; ms++) {
+			create_sim_advance(0.001);
+			while (create_sim_tx(&value)) {
+				// frames are [19][6][19][distance][20][angle][checksum]
+				if (have == 0 && value != OI_STREAM_HEADER) {
+					continue;
+				}
+				frame[have++] = value;
+				if (have == 9) {
+					have = 0;
+					if (frames < TEST_TRACE_SIZE) {
+						trace[frames].distance = (frame[3] << 8) | frame[4];
+						trace[frames].angle = (frame[6] << 8) | frame[7];
+						frames++;
+					}
+				}
+			}
+		}
+	}
+	create_sim_rx(OI_OPCODE_DO_STREAM);
+	create_sim_rx(0);
+	return frames;
+}
+
+// Runs a trace through poseUpdate and through the same odometry in double precision, and compares the two
+static void test_pose_trace(const char *name, const test_motion_t *trace, int frames, double max_mm) {
+	double x = 0, y = 0, theta = 0; // mm, mm, radians
+	double travelled = 0;
+	double error, heading_error;
+	Pose p;
+	int i;
+
+	poseReset();
+	for (i = 0; i < frames; i++) {
+		double turn = trace[i].angle * TEST_PI / 180;
+		poseUpdate(trace[i].distance, trace[i].angle);
+		x += trace[i].distance * cos(theta + turn / 2);
+		y += trace[i].distance * sin(theta + turn / 2);
+		theta += turn;
+		travelled += fabs(trace[i].distance);
+	}
+	poseGet(&p);
+	error = hypot(p.x / 256.0 - x, p.y / 256.0 - y);
+	heading_error = fabs(remainder((int32_t) p.theta * 360.0 / 4294967296.0 - theta * 180 / TEST_PI, 360));
+	check(error < max_mm, "%s: %d frames, %.0f mm driven, ends %.2f mm from the reference (%.1f, %.1f)", name, frames,
+	      travelled, error, x, y);
+	check(heading_error < 0.001, "%s: heading %.4f degrees off the reference", name, heading_error);
+	poseReset();
+}
+
+// Odometry against a double precision reference on recorded drives and on frames with large turns
+static void test_pose(void) {
+	static const int16_t drive[][3] = { // right mm/s, left mm/s, ms
+		{200, 200, 3000}, {150, 50, 4000}, {-100, 100, 2500}, {300, 280, 3000}, {-150, -150, 1500}, {50, 250, 5000},
+	};
+	static const int16_t spin[][3] = {{-400, 500, 8000}, {500, -350, 6000}}; // tight circles
+	static test_motion_t trace[TEST_TRACE_SIZE];
+	static const test_motion_t large[] = {
+		{100, 200}, {100, -250}, {50, 359}, {-80, -359}, {100, 181}, {100, -181}, {120, 720}, {30, -1000},
+	};
+	Pose p;
+	int frames;
+	long theta;
+
+	frames = test_record_trace(drive, sizeof(drive) / sizeof(drive[0]), trace);
+	test_pose_trace("recorded drive", trace, frames, 1.0);
+	frames = test_record_trace(spin, sizeof(spin) / sizeof(spin[0]), trace);
+	test_pose_trace("recorded tight circles", trace, frames, 1.0);
+	test_pose_trace("large turns in one frame", large, sizeof(large) / sizeof(large[0]), 1.0);
+
+	// headings just short of half a turn round to -180, not 180
+	for (theta = 0x7FFF0000L; theta <= 0x80010000L; theta += 0x2000) {
+		p.theta = (uint32_t) theta;
+		int reference = (int) lround((int32_t) p.theta * 360.0 / 4294967296.0);
+		if (reference == 180) {
+			reference = -180;
+		}
+		if (poseHeading(&p) != reference || poseHeading(&p) < -180 || poseHeading(&p) > 179) {
+			break;
+		}
+	}
+	check(theta > 0x80010000L, "poseHeading stays within -180..179 around half a turn");
+}
+
+// ---------------------------------------------------------------- distance conversions
+
+// The float conversions the integer tables replaced, as they were written for robot 4
+static int test_float_ir(int quantization) {
+	return 2364.5 * pow(quantization, -0.888);
+}
+
+static int test_float_ping(int delta) {
+	float distance = (delta * 0.06972973) + 3.6481622;
+	int roundingError = distance;
+	if (distance - roundingError > 0.5) {
+		return distance + 1;
+	}
+	return distance;
+}
+
+static int test_float_width(int cmDistance, int scannedDegrees) {
+	return (2 * cmDistance) * tan((scannedDegrees * 3.14) / 360);
+}
+
+// Host nanoseconds taken by running expression loops times; expression may use the loop counter
+static volatile int test_sink;
+#define TEST_TIME(result, loops, expression) do { \
+		struct timespec start, end; \
+		int loop; \
+		clock_gettime(CLOCK_MONOTONIC, &start); \
+		for (loop = 0; loop < (loops); loop++) { \
+			expression; \
+		} \
+		clock_gettime(CLOCK_MONOTONIC, &end); \
+		result = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)); \
+	} while (0)
+
+// Integer conversions against the float ones they replaced: the same results, and how much faster they are
+static void test_convert(void) {
+	int worst_ir = 0, worst_ping = 0, worst_width = 0;
+	double float_ns, integer_ns;
+	int q, delta, cm, degrees;
+
+	calibrationDefaults(); // robot 4, which the float formulas were measured on
+	for (q = 1; q < 1024; q++) {
+		if (test_float_ir(q) < 255) {
+			worst_ir = MAX(worst_ir, abs(irDistance(q) - test_float_ir(q)));
+		}
+	}
+	for (delta = 0; delta <= (int) PING_MAX_TICKS; delta++) {
+		worst_ping = MAX(worst_ping, abs(timeToDist(delta) - test_float_ping(delta)));
+	}
+	for (cm = 0; cm < 400; cm++) {
+		for (degrees = 0; degrees <= 170; degrees++) {
+			worst_width = MAX(worst_width, abs(objectWidth(cm, degrees) - test_float_width(cm, degrees)));
+		}
+	}
+	check(worst_ir == 0, "IR: table matches the float curve for every reading below 255 cm (worst %d cm)", worst_ir);
+	check(worst_ping <= 1, "ping: within %d cm of the float line for every echo up to %lu ticks", worst_ping,
+	      PING_MAX_TICKS);
+	check(worst_width <= 1, "width: within %d cm of the float formula for 0-399 cm and 0-170 degrees", worst_width);
+
+	// host timings only show the direction: the ATmega128 has no FPU, so its soft-float pow and tan cost far more
+	TEST_TIME(float_ns, 100, for (q = 1; q < 1024; q++) test_sink = test_float_ir(q));
+	TEST_TIME(integer_ns, 100, for (q = 1; q < 1024; q++) test_sink = irDistance(q));
+	printf("  time IR:    float %6.1f ns, table %6.1f ns per reading on this host\n", float_ns / 102300,
+	       integer_ns / 102300);
+	TEST_TIME(float_ns, 20, for (delta = 0; delta < 4625; delta++) test_sink = test_float_ping(delta));
+	TEST_TIME(integer_ns, 20, for (delta = 0; delta < 4625; delta++) test_sink = timeToDist(delta));
+	printf("  time ping:  float %6.1f ns, fixed %6.1f ns per echo on this host\n", float_ns / 92500,
+	       integer_ns / 92500);
+	TEST_TIME(float_ns, 500, for (degrees = 0; degrees <= 170; degrees++) test_sink = test_float_width(loop, degrees));
+	TEST_TIME(integer_ns, 500, for (degrees = 0; degrees <= 170; degrees++) test_sink = objectWidth(loop, degrees));
+	printf("  time width: float %6.1f ns, table %6.1f ns per object on this host\n", float_ns / 85500,
+	       integer_ns / 85500);
+}
+
+// ---------------------------------------------------------------- hazard
+
+// Sets all four cliff signals, left to right, and returns the hazards hazardUpdate finds in the frame
+static uint16_t test_floor(oi_t *frame, uint16_t left, uint16_t frontLeft, uint16_t frontRight, uint16_t right) {
+	frame->cliff_left_signal = left;
+	frame->cliff_frontleft_signal = frontLeft;
+	frame->cliff_frontright_signal = frontRight;
+	frame->cliff_right_signal = right;
+	hazardUpdate(frame);
+	return hazardActive() & HAZARD_TAPE;
+}
+
+// Tape hysteresis is per cliff sensor: one sensor on tape leaves the others on their full thresholds
+static void test_hazard(void) {
+	oi_t frame;
+
+	memset(&frame, 0, sizeof(frame));
+	calibrationDefaults();
+	calibration.whiteLeft = calibration.whiteFrontLeft = calibration.whiteFrontRight = calibration.whiteRight = 800;
+	calibration.whiteLeftRelease = calibration.whiteFrontLeftRelease = 700;
+	calibration.whiteFrontRightRelease = calibration.whiteRightRelease = 700;
+	calibration.blackLeft = calibration.blackFrontLeft = calibration.blackFrontRight = calibration.blackRight = 100;
+	calibration.blackLeftRelease = calibration.blackFrontLeftRelease = 150;
+	calibration.blackFrontRightRelease = calibration.blackRightRelease = 150;
+	hazardArm(0);
+
+	check(test_floor(&frame, 400, 400, 400, 400) == 0, "plain floor: no tape");
+	check(test_floor(&frame, 750, 400, 400, 400) == 0, "left between release and threshold: no tape yet");
+	check(test_floor(&frame, 850, 400, 400, 400) == HAZARD_WHITE_TAPE, "left over its threshold: white tape");
+	check(test_floor(&frame, 750, 400, 400, 400) == HAZARD_WHITE_TAPE, "left back above its release: still white");
+	check(test_floor(&frame, 750, 750, 400, 400) == HAZARD_WHITE_TAPE, "front left between thresholds as well");
+	check(test_floor(&frame, 650, 750, 400, 400) == 0,
+	      "left below its release: no tape, front left never crossed its own threshold");
+	check(test_floor(&frame, 400, 400, 400, 120) == 0, "right between black threshold and release: no tape yet");
+	check(test_floor(&frame, 400, 400, 90, 120) == HAZARD_BLACK_TAPE, "front right under its threshold: black tape");
+	check(test_floor(&frame, 400, 400, 120, 120) == HAZARD_BLACK_TAPE, "front right under its release: still black");
+	check(test_floor(&frame, 400, 400, 200, 120) == 0, "front right off the tape: right never crossed its own threshold");
+	check(test_floor(&frame, 850, 400, 400, 90) == (HAZARD_WHITE_TAPE | HAZARD_BLACK_TAPE),
+	      "white under the left sensor and black under the right one");
+	check(test_floor(&frame, 750, 400, 400, 400) == HAZARD_WHITE_TAPE, "and each holds on its own release");
+	frame.cliff_left = 1;
+	check(test_floor(&frame, 750, 400, 400, 400) == 0, "a cliff clears the tape");
+	frame.cliff_left = 0;
+	check(test_floor(&frame, 750, 400, 400, 400) == 0, "so the left sensor needs its full threshold again");
+	test_floor(&frame, 400, 400, 400, 400);
+	calibrationDefaults();
+}
+
+// Drives at the tape along the field edge and leaves the motion engine alone once it is moving, like a main loop
+// busy with something else: the receive interrupt has to stop the wheels by itself
+static void test_hazard_blocked(void) {
+	oi_t *sensor_data = test_boot();
+	unsigned long long start;
+	double x;
+
+	create_sim_place(1000, 0, 0);
+	motionQueueCommand(MOTION_TRANSLATE, 1000, 0);
+	for (start = sim_time(); sim_time() - start < 500000; sim_advance_us(100)) {
+		motionUpdate(sensor_data);
+	}
+	wait_ms(2000); // the main loop is blocked
+	x = create_sim_state()->x;
+	wait_ms(200);
+	check(x < CREATE_SIM_FIELD / 2 && create_sim_state()->x == x,
+	      "stopped on the tape while the main loop was blocked, %.0f mm from the field edge after the coast",
+	      CREATE_SIM_FIELD / 2 - x);
+	check(hazardTripped() == HAZARD_WHITE_TAPE, "the stop is flagged for the motion engine");
+	motionUpdate(sensor_data);
+	check(!motionBusy(), "which drops the rest of the move");
+	hazardClear();
+}
+
+// ---------------------------------------------------------------- sweep segmentation
+
+#define TEST_SWEEP 180
+
+// Records a sweep of the simulated field from where two posts are in view, one reading per servo degree: the
+// distance in cm to the nearest post along the sensor's bearing, 255 where there is none
+static void test_record_sweep(int cm[TEST_SWEEP]) {
+	int degree;
+
+	create_sim_init();
+	create_sim_place(250, -300, 0);
+	for (degree = 0; degree < TEST_SWEEP; degree++) {
+		double mm = create_sim_range((degree - 90) * TEST_PI / 180); // degree 90 is straight ahead
+		cm[degree] = (mm < 0 || mm >= 2550) ? 255 : (int) (mm / 10);
+	}
+	create_sim_init();
+}
+
+// Replays a sweep through the segmenter the way sweepScan does, pinging only the steps it asks for
+static void test_segment(ObjectPool *pool, const int ir[TEST_SWEEP], const int ping[TEST_SWEEP]) {
+	int degree;
+
+	segmentBegin(pool);
+	for (degree = 0; degree < TEST_SWEEP; degree++) {
+		segmentAdd(pool, degree, ir[degree], segmentNeedsPing(pool, ir[degree]) ? ping[degree] : -1);
+	}
+	segmentEnd(pool);
+}
+
+// Whether two pools hold the same objects
+static int test_same_objects(const ObjectPool *a, const ObjectPool *b) {
+	int i;
+
+	if (a->count != b->count || a->overflow != b->overflow) {
+		return 0;
+	}
+	for (i = 0; i < a->count; i++) {
+		if (a->objects[i].startDegree != b->objects[i].startDegree ||
+		    a->objects[i].scannedDegrees != b->objects[i].scannedDegrees ||
+		    a->objects[i].cmDistance != b->objects[i].cmDistance) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Replays a recorded sweep, then the same sweep with IR dropouts and a far spike, and checks the objects found
+static void test_sweep(void) {
+	static ObjectPool clean, noisy;
+	int cm[TEST_SWEEP], ir[TEST_SWEEP];
+	const Object *post;
+	int middle, degree;
+
+	test_record_sweep(cm);
+	test_segment(&clean, cm, cm);
+	check(clean.count == 2 && clean.overflow == 0, "recorded sweep: %d objects, both posts", clean.count);
+	if (clean.count != 2) {
+		return;
+	}
+	post = &clean.objects[1];
+	printf("  post at %d degrees, %d cm, %d degrees wide\n", post->degreePosition, post->cmDistance,
+	       post->scannedDegrees);
+	check(post->degreePosition >= 139 && post->degreePosition <= 142 && post->cmDistance >= 66 && post->cmDistance <= 68,
+	      "the nearer post is where the field puts it, about 141 degrees and 67 cm");
+	check(clean.objects[0].confidence == 100 && post->confidence == 100, "IR and ping agree on every step");
+
+	middle = post->startDegree + post->scannedDegrees / 2;
+	memcpy(ir, cm, sizeof(ir));
+	ir[middle] = 255;
+	test_segment(&noisy, ir, cm);
+	check(test_same_objects(&clean, &noisy), "one step of IR noise in a post: the same objects (%d)", noisy.count);
+
+	ir[clean.objects[0].startDegree + 1] = 255;
+	test_segment(&noisy, ir, cm);
+	check(test_same_objects(&clean, &noisy), "a step of noise in each post: the same objects (%d)", noisy.count);
+
+	memcpy(ir, cm, sizeof(ir));
+	ir[middle] = ir[middle + 1] = 255;
+	test_segment(&noisy, ir, cm);
+	check(noisy.count == 3 && noisy.objects[1].startDegree == post->startDegree &&
+	      noisy.objects[2].startDegree == middle + 2, "two steps without the post split it in two (%d objects)",
+	      noisy.count);
+
+	memcpy(ir, cm, sizeof(ir));
+	ir[post->startDegree + post->scannedDegrees - 1] = 255;
+	test_segment(&noisy, ir, cm);
+	check(noisy.count == 2 && noisy.objects[1].scannedDegrees == post->scannedDegrees - 1,
+	      "noise on the post's last step: the post ends a step early, %d degrees", noisy.objects[1].scannedDegrees);
+
+	memcpy(ir, cm, sizeof(ir));
+	ir[middle] = 255;
+	for (degree = middle + 1; degree < TEST_SWEEP; degree++) {
+		if (cm[degree] < 255) {
+			ir[degree] = cm[degree] + SEGMENT_JUMP_CM + 10; // something further back, in range but too far to start an object
+		}
+	}
+	test_segment(&noisy, ir, ir);
+	check(noisy.count == 2 && noisy.objects[1].startDegree + noisy.objects[1].scannedDegrees == middle,
+	      "a ping jump after the noise still ends the post before the noise, at %d degrees",
+	      noisy.objects[1].startDegree + noisy.objects[1].scannedDegrees - 1);
+
+	for (degree = 0; degree < TEST_SWEEP; degree++) {
+		ir[degree] = (degree % 4 < 2) ? 40 : 255; // two steps on, two off
+	}
+	test_segment(&noisy, ir, ir);
+	check(noisy.count == SEGMENT_CAPACITY && noisy.overflow == TEST_SWEEP / 4 - SEGMENT_CAPACITY,
+	      "more objects than the pool holds: %d kept, %d counted", noisy.count, noisy.overflow);
+}
+
+// ---------------------------------------------------------------- runner
+
+typedef struct {
+	const char *name;
+	void (*run)(void);
+	const char *about;
+} test_t;
+
+static const test_t tests[] = {
+	{"stream", test_stream, "stream frame parser on recorded and corrupted streams"},
+	{"packets", test_packet_list, "packet lists longer than a stream frame"},
+	{"motion", test_motion_packets, "sensor packets streamed for each kind of motion"},
+	{"turns", test_turns, "remote-control rotations against the model's coast after a stop"},
+	{"baud", test_baud, "link rate negotiation over the simulated serial link"},
+	{"serial", test_serial, "the millisecond clock and terminal output through util.c and serial.c"},
+	{"decode", test_packets, "sensor packet decoding through the descriptor table"},
+	{"pose", test_pose, "fixed-point odometry against a double precision reference"},
+	{"hazard", test_hazard, "tape hysteresis for each cliff sensor"},
+	{"blocked", test_hazard_blocked, "a hazard stopping the wheels while the main loop is blocked"},
+	{"sweep", test_sweep, "scan segmentation on a recorded sweep, with IR noise"},
+	{"convert", test_convert, "integer distance conversions against the float code they replaced, with timings"},
+};
+
+int main(int argc, char **argv) {
+	unsigned t;
+	int i;
+
+	sim_avr_init();
+	clock_init();
+	USART_Init(16); // 57600 baud, as Rover.c sets it
+	for (t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+		int selected = (argc < 2);
+		for (i = 1; i < argc; i++) {
+			selected |= strcmp(argv[i], tests[t].name) == 0;
+		}
+		if (!selected) {
+			continue;
+		}
+		printf("%s: %s\n", tests[t].name, tests[t].about);
+		tests[t].run();
+	}
+	printf("%d checks, %d failed\n", test_checks, test_failures);
+	return test_failures ? 1 : 0;
+}
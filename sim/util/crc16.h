@@ -0,0 +1,19 @@
+/**
+ * util/crc16.h: host stand-in for the avr-libc CRC helpers the firmware uses
+ */
+
+#ifndef SIM_UTIL_CRC16_H
+#define SIM_UTIL_CRC16_H
+
+#include <stdint.h>
+
+// CRC-8 with polynomial 0x07, one byte at a time, as avr-libc computes it
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data) {
+	crc ^= data;
+	for (int i = 0; i < 8; i++) {
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+	return crc;
+}
+
+#endif
\ No newline at end of file
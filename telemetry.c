@@ -0,0 +1,141 @@
+/*
+ * telemetry.c
+ *
+ * Created: 10/17/2026 8:50:42 PM
+ */ 
+
+#include <avr/io.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "serial.h"
+#include "pose.h"
+#include "telemetry.h"
+
+static char telemetryOn = 0; //off by default - the binary frames would garble a terminal
+static uint8_t telemetrySequence = 0; //sequence number of the next frame, so the host can tell frames were lost
+static uint16_t telemetryLost = 0; //frames dropped because the transmit queue was full
+static uint8_t records[TELEMETRY_MAX_PAYLOAD]; //step records waiting for a full frame
+static uint8_t recordBytes = 0;
+static int lastDegree; //servo position of the last step record
+
+// Puts a frame in the transmit queue, or drops it whole if the link is behind
+static void telemetrySend(uint8_t type, const uint8_t *payload, uint8_t length) {
+	uint8_t frame[TELEMETRY_HEADER + TELEMETRY_MAX_PAYLOAD + 1];
+	uint8_t crc = 0;
+	
+	frame[0] = TELEMETRY_SYNC;
+	frame[1] = type;
+	frame[2] = telemetrySequence++;
+	frame[3] = length;
+	memcpy(frame + TELEMETRY_HEADER, payload, length);
+	for (uint8_t i = 1; i < TELEMETRY_HEADER + length; i++) {
+		crc = _crc8_ccitt_update(crc, frame[i]);
+	}
+	frame[TELEMETRY_HEADER + length] = crc;
+	if (!serial_try_put(frame, TELEMETRY_HEADER + length + 1) && telemetryLost < 0xFFFF) {
+		telemetryLost++;
+	}
+}
+
+// Sends the step records collected so far
+static void telemetryFlush(void) {
+	if (recordBytes) {
+		telemetrySend(TELEMETRY_SCAN_STEPS, records, recordBytes);
+		recordBytes = 0;
+	}
+}
+
+// Stores a value little endian
+static void putInt16(uint8_t *to, int16_t value) {
+	to[0] = value & 0xFF;
+	to[1] = (uint16_t) value >> 8;
+}
+
+/// Turns the scan telemetry stream on or off
+/**
+ * @param on 1 to stream the readings of every scan, 0 to stop
+ */
+void telemetryEnable(char on) {
+	telemetryOn = on;
+}
+
+/// Whether scans stream their readings
+/**
+ * @return 1 if the telemetry stream is on
+ */
+char telemetryEnabled(void) {
+	return telemetryOn;
+}
+
+/// Frames dropped because the link couldn't keep up
+/**
+ * @param reset 1 to start counting again after reading
+ * @return frames dropped since the last reset
+ */
+uint16_t telemetryDropped(char reset) {
+	uint16_t lost = telemetryLost;
+	
+	if (reset) {
+		telemetryLost = 0;
+	}
+	return lost;
+}
+
+/// Starts the telemetry of a scan
+/**
+ * Sends where the robot is, so the host can place the readings that follow
+ * @param kind which scan this is, e.g. 'r' for sweepScan
+ */
+void telemetryScanStart(char kind) {
+	uint8_t payload[7];
+	Pose p;
+	
+	if (!telemetryOn) {
+		return;
+	}
+	recordBytes = 0;
+	poseGet(&p);
+	payload[0] = kind;
+	putInt16(payload + 1, p.x >> 8);
+	putInt16(payload + 3, p.y >> 8);
+	putInt16(payload + 5, poseHeading(&p));
+	telemetrySend(TELEMETRY_SCAN_START, payload, sizeof(payload));
+}
+
+/// Adds one scan step to the telemetry
+/**
+ * Costs three bytes in a buffer, and a frame in the transmit queue every TELEMETRY_BATCH steps - never waits for the link
+ * @param degree servo position of the step
+ * @param irCm IR distance of the step in cm
+ * @param pingCm ping distance of the step in cm, -1 if the step wasn't pinged, sent as 0
+ */
+void telemetryScanStep(int degree, int irCm, int pingCm) {
+	if (!telemetryOn) {
+		return;
+	}
+	records[recordBytes] = recordBytes ? (int8_t) (degree - lastDegree) : degree; //scans step a few degrees at a time, either way
+	recordBytes++;
+	records[recordBytes++] = (irCm > 255) ? 255 : irCm;
+	records[recordBytes++] = (pingCm < 0) ? 0 : (pingCm > 255) ? 255 : pingCm;
+	lastDegree = degree;
+	if (recordBytes == TELEMETRY_MAX_PAYLOAD) {
+		telemetryFlush();
+	}
+}
+
+/// Finishes the telemetry of a scan
+/**
+ * @param samples servo positions the scan sampled
+ * @param ms how long the scan took
+ */
+void telemetryScanEnd(unsigned samples, unsigned ms) {
+	uint8_t payload[4];
+	
+	if (!telemetryOn) {
+		return;
+	}
+	telemetryFlush();
+	putInt16(payload, samples);
+	putInt16(payload + 2, ms);
+	telemetrySend(TELEMETRY_SCAN_END, payload, sizeof(payload));
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+/*
+ * telemetry.h
+ *
+ * Created: 10/17/2026 8:51:17 PM
+ */ 
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+//Frames: TELEMETRY_SYNC, type, sequence number, payload length, payload, CRC-8 (polynomial 0x07) of everything after the
+//sync byte. Multi-byte values are little endian.
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_HEADER 4 //bytes in front of the payload
+#define TELEMETRY_SCAN_START 'S' //payload: scan kind ('r', 'R', 's' or 'v'), pose x and y in mm and heading in degrees, int16 each
+#define TELEMETRY_SCAN_STEPS 'D' //payload: up to TELEMETRY_BATCH step records
+#define TELEMETRY_SCAN_END 'E' //payload: samples, then scan time in ms, uint16 each
+#define TELEMETRY_RECORD 3 //bytes per step record: degrees since the last step (int8) - the servo position (uint8) in
+                           //a frame's first record, so a lost frame doesn't shift the rest - then IR cm, ping cm (0 if not pinged)
+#define TELEMETRY_BATCH 8 //step records per frame
+#define TELEMETRY_MAX_PAYLOAD (TELEMETRY_BATCH * TELEMETRY_RECORD)
+
+void telemetryEnable(char on);
+
+char telemetryEnabled(void);
+
+uint16_t telemetryDropped(char reset);
+
+void telemetryScanStart(char kind);
+
+void telemetryScanStep(int degree, int irCm, int pingCm);
+
+void telemetryScanEnd(unsigned samples, unsigned ms);
+
+#endif /* TELEMETRY_H */
\ No newline at end of file
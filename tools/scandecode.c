@@ -0,0 +1,125 @@
+/**
+ * scandecode.c: turns a capture of the robot's binary scan telemetry into CSV
+ *
+ * Build from the repository root:
+ *   gcc -std=gnu99 -I. -o scandecode tools/scandecode.c -lm
+ *
+ * Usage:
+ *   ./scandecode capture.bin > scans.csv   or   ./scandecode < capture.bin > scans.csv
+ *
+ * The capture is everything the robot sent over the bluetooth link with telemetry on (press b), e.g. logged by
+ * PuTTY as raw data, or written by the simulator with -t. Text between the frames is skipped. Prints one line per
+ * scan step:
+ *   scan,kind,degree,ir_cm,ping_cm,x_mm,y_mm
+ * where x_mm and y_mm place what the sensors saw in the field, the same way the robot's map does, and are empty
+ * when nothing was in range - filter on them for a point cloud. Frames that fail their CRC and frames lost in
+ * between (gaps in the sequence numbers) are counted on stderr.
+ *
+ * @date 10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "telemetry.h"
+#include "segment.h"
+
+static unsigned scans = 0, steps = 0, frames = 0, crcErrors = 0, lost = 0;
+static int kind = '?', degree = 0;
+static double poseX = 0, poseY = 0, heading = 0; // robot pose when the current scan started, mm and radians
+
+// CRC-8 with polynomial 0x07, like _crc8_ccitt_update on the robot
+static uint8_t crc8(uint8_t crc, uint8_t data) {
+	crc ^= data;
+	for (int i = 0; i < 8; i++) {
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+	return crc;
+}
+
+static int16_t int16At(const uint8_t *p) {
+	return (int16_t) (p[0] | (p[1] << 8));
+}
+
+// One step: where the robot's map would put a hit (gridScanStep), or nothing
+static void step(int ir, int ping) {
+	printf("%u,%c,%d,%d,%d,", scans, kind, degree, ir, ping);
+	if (ir < SEGMENT_START_CM) {
+		double range = 10.0 * ((abs(ir - ping) <= SEGMENT_AGREE_CM) ? ping : ir);
+		double bearing = heading + (degree - 90) * M_PI / 180;
+		printf("%.0f,%.0f\n", poseX + range * cos(bearing), poseY + range * sin(bearing));
+	}
+	else {
+		printf(",\n");
+	}
+	steps++;
+}
+
+static void frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+	if (type == TELEMETRY_SCAN_START && length == 7) {
+		scans++;
+		kind = payload[0];
+		poseX = int16At(payload + 1);
+		poseY = int16At(payload + 3);
+		heading = int16At(payload + 5) * M_PI / 180;
+	}
+	else if (type == TELEMETRY_SCAN_STEPS && length % TELEMETRY_RECORD == 0) {
+		for (int i = 0; i < length; i += TELEMETRY_RECORD) {
+			degree = i ? degree + (int8_t) payload[i] : payload[i];
+			step(payload[i + 1], payload[i + 2]);
+		}
+	}
+	else if (type == TELEMETRY_SCAN_END && length == 4) {
+		fprintf(stderr, "scan %u (%c): %u samples in %u ms\n", scans, kind, (uint16_t) int16At(payload), (uint16_t) int16At(payload + 2));
+	}
+}
+
+int main(int argc, char **argv) {
+	FILE *in = stdin;
+	uint8_t buffer[TELEMETRY_HEADER + 255 + 1];
+	int expected = -1; // next sequence number, -1 before the first frame
+	int c;
+
+	if (argc > 1 && !(in = fopen(argv[1], "rb"))) {
+		perror(argv[1]);
+		return 1;
+	}
+	printf("scan,kind,degree,ir_cm,ping_cm,x_mm,y_mm\n");
+	while ((c = fgetc(in)) != EOF) {
+		if (c != TELEMETRY_SYNC) {
+			continue; // text, or the rest of a damaged frame
+		}
+		long resync = ftell(in); // where to look for the next sync byte if this wasn't a frame
+		buffer[0] = c;
+		if (fread(buffer + 1, 1, TELEMETRY_HEADER - 1, in) != TELEMETRY_HEADER - 1) {
+			break;
+		}
+		uint8_t length = buffer[3];
+		if (length > TELEMETRY_MAX_PAYLOAD || fread(buffer + TELEMETRY_HEADER, 1, length + 1, in) != (size_t) length + 1) {
+			if (length > TELEMETRY_MAX_PAYLOAD && resync >= 0 && fseek(in, resync, SEEK_SET) == 0) {
+				continue;
+			}
+			break;
+		}
+		uint8_t crc = 0;
+		for (int i = 1; i < TELEMETRY_HEADER + length; i++) {
+			crc = crc8(crc, buffer[i]);
+		}
+		if (crc != buffer[TELEMETRY_HEADER + length]) {
+			crcErrors++;
+			if (resync >= 0 && fseek(in, resync, SEEK_SET) == 0) {
+				continue;
+			}
+			break;
+		}
+		if (expected >= 0 && buffer[2] != expected) {
+			lost += (uint8_t) (buffer[2] - expected);
+		}
+		expected = (uint8_t) (buffer[2] + 1);
+		frames++;
+		frame(buffer[1], buffer + TELEMETRY_HEADER, length);
+	}
+	fprintf(stderr, "%u frames, %u scans, %u steps, %u CRC errors, %u frames lost\n", frames, scans, steps, crcErrors, lost);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,258 @@
+/*
+ * track.c
+ *
+ * Created: 10/17/2026 9:35:47 PM
+ */ 
+
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "serial.h"
+#include "pose.h"
+#include "segment.h"
+#include "track.h"
+
+static Track tracks[TRACK_CAPACITY];
+static uint8_t nextId = 1;
+
+// Where a track should be by now, from its last position and velocity
+static void trackPredict(const Track *track, unsigned long now, int32_t *x, int32_t *y) {
+	long dt = now - track->seen; //ms
+	
+	*x = track->x + (int32_t) track->vx * dt / 1000;
+	*y = track->y + (int32_t) track->vy * dt / 1000;
+}
+
+// Servo position and distance from the robot to a point in the pose's frame
+static void trackRelative(const Pose *p, int32_t x, int32_t y, int *degree, int *cm) {
+	int32_t dx = x - (p->x >> 8);
+	int32_t dy = y - (p->y >> 8);
+	int16_t bearing;
+	
+	if (labs(dx) > 32000 || labs(dy) > 32000) { //off the field, and off poseAtan2's scale
+		*degree = -1;
+		*cm = 32767;
+		return;
+	}
+	bearing = poseAtan2(dy, dx) - (int16_t) (p->theta >> 16); //binary angle from the heading, 65536 is a full turn
+	*degree = 90 + (((int32_t) bearing * 360 + 32768) >> 16);
+	*cm = poseSqrt((unsigned long) (dx * dx + dy * dy)) / 10;
+}
+
+// Whether the scans can see a point: in front of the servo and near enough for the IR sensor to start an object
+static char trackVisible(int degree, int cm) {
+	return degree >= 0 && degree < 180 && cm < SEGMENT_START_CM;
+}
+
+// Adds a sighting to a track - an alpha-beta filter: the position moves halfway to the sighting, the velocity a quarter
+// of the way to what would explain the miss
+static void trackHit(Track *track, int32_t x, int32_t y, int cmWidth, unsigned long now) {
+	long dt = now - track->seen;
+	int32_t px, py;
+	
+	if (dt < 1) {
+		dt = 1;
+	}
+	trackPredict(track, now, &px, &py);
+	if (track->hits == 1) { //second sighting, the first velocity there is
+		track->vx = (x - track->x) * 1000 / dt;
+		track->vy = (y - track->y) * 1000 / dt;
+		track->x = x;
+		track->y = y;
+	}
+	else {
+		track->x = px + (x - px) / 2;
+		track->y = py + (y - py) / 2;
+		track->vx += (x - px) * 250 / dt;
+		track->vy += (y - py) * 250 / dt;
+	}
+	track->cmWidth = cmWidth;
+	track->seen = now;
+	track->misses = 0;
+	if (track->hits < 255) {
+		track->hits++;
+	}
+	track->moving = track->hits >= TRACK_CONFIRMED_HITS
+		&& poseSqrt((unsigned long) ((int32_t) track->vx * track->vx + (int32_t) track->vy * track->vy)) >= TRACK_MOVING_MM_S;
+}
+
+// Counts a scan that should have seen a track and didn't, dropping the track after too many
+static void trackMiss(Track *track) {
+	if (++track->misses > TRACK_MAX_MISSES) {
+		track->id = 0;
+	}
+}
+
+/// Forgets every track
+/**
+ * Call when the pose is reset, since tracks are kept in the pose's frame
+ */
+void trackReset(void) {
+	memset(tracks, 0, sizeof(tracks));
+}
+
+/// One track slot
+/**
+ * @param index slot, 0 to TRACK_CAPACITY - 1
+ * @return the track, with id 0 if the slot is unused
+ */
+const Track *trackGet(uint8_t index) {
+	return &tracks[index];
+}
+
+/// Associates the objects of a full scan with the tracks
+/**
+ * Each object is placed in the pose's frame, so the robot's own motion between scans doesn't look like the objects
+ * moving, and goes to the track whose predicted position is nearest in bearing and distance, within
+ * TRACK_GATE_DEGREES and TRACK_GATE_CM. Objects without a track start one while there is a free slot. Tracks the
+ * scan should have seen but didn't count a miss.
+ * @param pool the objects the scan found
+ * @param now clock_ms() at the end of the scan
+ */
+void trackScan(const ObjectPool *pool, unsigned long now) {
+	char updated[TRACK_CAPACITY];
+	Pose p;
+	
+	memset(updated, 0, sizeof(updated));
+	poseGet(&p);
+	for (uint8_t i = 0; i < pool->count; i++) {
+		const Object *object = &pool->objects[i];
+		int cm = object->cmDistance + object->cmWidth / 2; //to the middle of the object
+		uint32_t direction = p.theta + (int32_t) (object->degreePosition - 90) * BINARY_DEGREE;
+		int32_t x = (p.x >> 8) + (((int32_t) cm * 10 * poseCos(direction)) >> 14);
+		int32_t y = (p.y >> 8) + (((int32_t) cm * 10 * poseSin(direction)) >> 14);
+		int best = -1;
+		int bestCost = 0;
+		
+		for (uint8_t t = 0; t < TRACK_CAPACITY; t++) {
+			int32_t px, py;
+			int degree, range;
+			
+			if (!tracks[t].id || updated[t]) {
+				continue;
+			}
+			trackPredict(&tracks[t], now, &px, &py);
+			trackRelative(&p, px, py, &degree, &range);
+			int offDegrees = abs(degree - object->degreePosition);
+			int offCm = abs(range - cm);
+			if (offDegrees > TRACK_GATE_DEGREES || offCm > TRACK_GATE_CM) {
+				continue;
+			}
+			int cost = offDegrees * TRACK_GATE_CM + offCm * TRACK_GATE_DEGREES; //both gates count the same
+			if (best < 0 || cost < bestCost) {
+				best = t;
+				bestCost = cost;
+			}
+		}
+		if (best < 0) { //a new object, if there is room to follow it
+			for (uint8_t t = 0; t < TRACK_CAPACITY && best < 0; t++) {
+				if (!tracks[t].id) {
+					best = t;
+					memset(&tracks[t], 0, sizeof(Track));
+					tracks[t].id = nextId;
+					nextId = (nextId == 255) ? 1 : nextId + 1;
+					tracks[t].x = x;
+					tracks[t].y = y;
+					tracks[t].cmWidth = object->cmWidth;
+					tracks[t].seen = now;
+					tracks[t].hits = 1;
+				}
+			}
+		}
+		else {
+			trackHit(&tracks[best], x, y, object->cmWidth, now);
+		}
+		if (best >= 0) {
+			updated[best] = 1;
+		}
+	}
+	
+	for (uint8_t t = 0; t < TRACK_CAPACITY; t++) {
+		int32_t px, py;
+		int degree, range;
+		
+		if (!tracks[t].id || updated[t]) {
+			continue;
+		}
+		trackPredict(&tracks[t], now, &px, &py);
+		trackRelative(&p, px, py, &degree, &range);
+		if (trackVisible(degree, range)) {
+			trackMiss(&tracks[t]);
+		}
+	}
+}
+
+/// Where to look for a track
+/**
+ * @param index slot of the track
+ * @param now clock_ms()
+ * @param *degree set to the servo position that points at the track
+ * @param *cm set to the distance the ping sensor should measure to its near side
+ * @return 1 if the track should be in view of the sensors
+ */
+char trackExpect(uint8_t index, unsigned long now, int *degree, int *cm) {
+	Pose p;
+	int32_t x, y;
+	
+	poseGet(&p);
+	trackPredict(&tracks[index], now, &x, &y);
+	trackRelative(&p, x, y, degree, cm);
+	*cm -= tracks[index].cmWidth / 2;
+	return tracks[index].id && trackVisible(*degree, *cm);
+}
+
+/// Adds a quick look at a track to it
+/**
+ * For a track that isn't moving: a reading near where trackExpect said counts as a sighting in the same place,
+ * anything else as a miss
+ * @param index slot of the track
+ * @param now clock_ms() when the reading was taken
+ * @param cm ping distance at the track's servo position, -1 if nothing was seen there
+ */
+void trackConfirm(uint8_t index, unsigned long now, int cm) {
+	Track *track = &tracks[index];
+	int degree, expected;
+	
+	if (!trackExpect(index, now, &degree, &expected)) {
+		return;
+	}
+	if (cm < 0 || abs(cm - expected) > TRACK_GATE_CM) {
+		trackMiss(track);
+		return;
+	}
+	track->seen = now;
+	track->misses = 0;
+	if (track->hits < 255) {
+		track->hits++;
+	}
+}
+
+/// Sends the tracks over serial
+/**
+ * One line per track with its id, where it is from the robot, and whether it moves - velocities are in the pose's
+ * frame, x forward from where the pose was reset
+ */
+void trackReport(void) {
+	char report[96];
+	Pose p;
+	
+	poseGet(&p);
+	for (uint8_t t = 0; t < TRACK_CAPACITY; t++) {
+		int degree, cm;
+		
+		if (!tracks[t].id) {
+			continue;
+		}
+		trackRelative(&p, tracks[t].x, tracks[t].y, &degree, &cm);
+		if (tracks[t].moving) {
+			sprintf(report, "Track %d at %d degrees, %d cm: MOVING, %d mm/s along x, %d mm/s along y\n\r", tracks[t].id, degree, cm,
+				tracks[t].vx, tracks[t].vy);
+		}
+		else {
+			sprintf(report, "Track %d at %d degrees, %d cm: %s, seen %d times\n\r", tracks[t].id, degree, cm,
+				(tracks[t].hits >= TRACK_CONFIRMED_HITS) ? "static" : "new", tracks[t].hits);
+		}
+		serial_putString(report, strlen(report));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+/*
+ * track.h
+ *
+ * Created: 10/17/2026 9:36:08 PM
+ */ 
+
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <stdint.h>
+#include "segment.h"
+
+#define TRACK_CAPACITY 8 //objects followed at once
+#define TRACK_GATE_DEGREES 10 //furthest an object may be from where a track was expected, in bearing...
+#define TRACK_GATE_CM 25 //...and in distance, to belong to the track
+#define TRACK_MAX_MISSES 2 //scans in a row a track in view may go unseen before it is dropped
+#define TRACK_CONFIRMED_HITS 2 //sightings before a track's velocity means anything
+#define TRACK_MOVING_MM_S 40 //speed from which a track counts as moving - slower is measurement noise
+
+typedef struct { //an object followed from scan to scan, in the pose's frame
+	uint8_t id; //stays the same while the object is followed, 0 for an unused slot
+	int32_t x; //middle of the object, mm forward of the origin
+	int32_t y; //mm left of the origin
+	int16_t vx; //velocity, mm/s
+	int16_t vy;
+	int16_t cmWidth;
+	unsigned long seen; //clock_ms() of the last sighting
+	uint8_t hits; //sightings, saturating
+	uint8_t misses; //scans in a row that should have seen it and didn't
+	char moving; //flagged for avoidance
+} Track;
+
+void trackReset(void);
+
+const Track *trackGet(uint8_t index);
+
+void trackScan(const ObjectPool *pool, unsigned long now);
+
+char trackExpect(uint8_t index, unsigned long now, int *degree, int *cm);
+
+void trackConfirm(uint8_t index, unsigned long now, int cm);
+
+void trackReport(void);
+
+#endif /* TRACK_H */
\ No newline at end of file
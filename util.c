@@ -14,6 +14,8 @@
 
 // Global used for interrupt driven delay functions
 volatile unsigned int timer2_tick;
+// Global used by the free-running millisecond clock
+volatile unsigned long timer0_ms;
 void timer2_start(char unit);
 void timer2_stop();
 
@@ -61,6 +63,56 @@ ISR (TIMER2_COMP_vect) {
 
 
 
+/// Start the free-running millisecond clock
+/**
+ * Timer0 runs continuously (unlike timer2, which only runs inside wait_ms) so it can timestamp events.
+ */
+void clock_init(void) {
+	OCR0=249;				//Clock is 16 MHz. At a prescaler of 64, 250 timer ticks = 1ms.
+	TCCR0=0b00001100;		//WGM:CTC, COM:OC0 disconnected, pre_scaler = 64
+	TIMSK|=0b00000010;		//Enabling O.C. Interrupt for Timer0
+	sei();
+}
+
+
+/// Milliseconds since clock_init() was called
+unsigned long clock_ms(void) {
+	unsigned long ms;
+	char sreg = SREG;
+	cli();					//32-bit value is updated by the interrupt
+	ms = timer0_ms;
+	SREG = sreg;
+	return ms;
+}
+
+
+/// Microseconds since clock_init() was called, in 4 us steps
+/**
+ * Adds timer0's count within the current millisecond to clock_ms(), for timing things shorter than a millisecond.
+ * Wraps after about 71 minutes, so only differences between close readings mean anything.
+ */
+unsigned long clock_us(void) {
+	unsigned long ms;
+	uint8_t ticks;
+	char sreg = SREG;
+	cli();
+	ms = timer0_ms;
+	ticks = TCNT0;
+	if ((TIFR & (1 << OCF0)) && ticks < 125) { //the count wrapped but the interrupt hasn't counted that millisecond yet
+		ms++;
+	}
+	SREG = sreg;
+	return ms * 1000 + ticks * 4UL;
+}
+
+
+// Interrupt handler for the millisecond clock
+ISR (TIMER0_COMP_vect) {
+	timer0_ms++;
+}
+
+
+
 
 /// Initialize PORTC to accept push buttons as input
 void init_push_buttons(void) {
@@ -1,6 +1,15 @@
 /// Blocks for a specified number of milliseconds
 void wait_ms(unsigned int time_val);
 
+/// Start the free-running millisecond clock (timer0)
+void clock_init(void);
+
+/// Milliseconds since clock_init() was called
+unsigned long clock_ms(void);
+
+/// Microseconds since clock_init() was called, in 4 us steps; for short intervals only
+unsigned long clock_us(void);
+
 /// Shaft encoder initialization
 void shaft_encoder_init(void);
 